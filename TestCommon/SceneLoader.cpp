@@ -0,0 +1,92 @@
+#include "SceneLoader.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <rapidxml.hpp>
+
+#ifdef SCENE_LOADER_FORCES
+#include "FOSSSim/SpringForce.h"
+#include "FOSSSim/DragDampingForce.h"
+#include "FOSSSim/SimpleGravityForce.h"
+#include "FOSSSim/GravitationalForce.h"
+#endif
+
+namespace
+{
+  scalar attribute( rapidxml::xml_node<>* node, const char* name, scalar fallback = 0.0 )
+  {
+    rapidxml::xml_attribute<>* attr = node->first_attribute( name );
+    return attr == NULL ? fallback : std::strtod( attr->value(), NULL );
+  }
+
+  int count( rapidxml::xml_node<>* scene, const char* name )
+  {
+    int n = 0;
+    for( rapidxml::xml_node<>* node = scene->first_node( name ); node != NULL; node = node->next_sibling( name ) ) ++n;
+    return n;
+  }
+}
+
+bool loadScene( const std::string& filename, TwoDScene& scene, scalar& dt )
+{
+  std::ifstream file( filename.c_str() );
+  if( !file ) return false;
+  std::vector<char> text( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+  text.push_back( '\0' );
+
+  rapidxml::xml_document<> doc;
+  doc.parse<0>( &text[0] );
+  rapidxml::xml_node<>* root = doc.first_node( "scene" );
+  if( root == NULL ) return false;
+
+  rapidxml::xml_node<>* integrator = root->first_node( "integrator" );
+  dt = integrator == NULL ? 0.01 : attribute( integrator, "dt", 0.01 );
+
+  scene.resizeSystem( count( root, "particle" ) );
+  int i = 0;
+  for( rapidxml::xml_node<>* node = root->first_node( "particle" ); node != NULL; node = node->next_sibling( "particle" ), ++i )
+  {
+    scene.setPosition( i, Vector2s( attribute( node, "px" ), attribute( node, "py" ) ) );
+    scene.setVelocity( i, Vector2s( attribute( node, "vx" ), attribute( node, "vy" ) ) );
+    scene.setMass( i, attribute( node, "m", 1.0 ) );
+    scene.setFixed( i, attribute( node, "fixed" ) != 0.0 );
+    scene.setRadius( i, attribute( node, "radius", 0.1 ) );
+  }
+
+  for( rapidxml::xml_node<>* node = root->first_node( "edge" ); node != NULL; node = node->next_sibling( "edge" ) )
+    scene.insertEdge( std::pair<int,int>( (int) attribute( node, "i" ), (int) attribute( node, "j" ) ), attribute( node, "radius", 0.1 ) );
+
+#ifdef SCENE_LOADER_HALFPLANES
+  for( rapidxml::xml_node<>* node = root->first_node( "halfplane" ); node != NULL; node = node->next_sibling( "halfplane" ) )
+  {
+    VectorXs position(2), normal(2);
+    position << attribute( node, "px" ), attribute( node, "py" );
+    normal << attribute( node, "nx" ), attribute( node, "ny" );
+    scene.insertHalfplane( std::make_pair( position, normal ) );
+  }
+#endif
+
+#ifdef SCENE_LOADER_FORCES
+  for( rapidxml::xml_node<>* node = root->first_node( "springforce" ); node != NULL; node = node->next_sibling( "springforce" ) )
+    scene.insertForce( new SpringForce( scene.getEdge( (int) attribute( node, "edge" ) ), attribute( node, "k" ), attribute( node, "l0" ), attribute( node, "b" ) ) );
+
+  for( rapidxml::xml_node<>* node = root->first_node( "simplegravity" ); node != NULL; node = node->next_sibling( "simplegravity" ) )
+    scene.insertForce( new SimpleGravityForce( Vector2s( attribute( node, "fx" ), attribute( node, "fy" ) ) ) );
+
+  for( rapidxml::xml_node<>* node = root->first_node( "dragdamping" ); node != NULL; node = node->next_sibling( "dragdamping" ) )
+    scene.insertForce( new DragDampingForce( attribute( node, "b" ) ) );
+
+  for( rapidxml::xml_node<>* node = root->first_node( "gravitationalforce" ); node != NULL; node = node->next_sibling( "gravitationalforce" ) )
+    scene.insertForce( new GravitationalForce( std::pair<int,int>( (int) attribute( node, "i" ), (int) attribute( node, "j" ) ), attribute( node, "G" ) ) );
+#endif
+
+  return true;
+}
+
+std::string assetPath( const std::string& scene )
+{
+  return std::string( FOSSSIM_ASSETS_DIR ) + "/" + scene;
+}
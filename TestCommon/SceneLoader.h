@@ -0,0 +1,19 @@
+#ifndef __SCENE_LOADER_H__
+#define __SCENE_LOADER_H__
+
+#include <string>
+
+#include "FOSSSim/TwoDScene.h"
+
+// Reads the particles and edges of a scene file into scene, and the
+// integrator's time step into dt. The full parser lives in each module's base
+// library and is not exposed, so this only understands the tags the tests
+// need. Modules whose scenes have them define SCENE_LOADER_HALFPLANES to read
+// halfplanes and SCENE_LOADER_FORCES to read the forces; everything else is
+// skipped. Returns false if the file can't be read.
+bool loadScene( const std::string& filename, TwoDScene& scene, scalar& dt );
+
+// Path of a scene file under the module's assets directory
+std::string assetPath( const std::string& scene );
+
+#endif
@@ -0,0 +1,176 @@
+#include "BandedCholeskySolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "ReverseCuthillMcKee.h"
+
+BandedCholeskySolver::BandedCholeskySolver( int max_bandwidth )
+: m_max_bandwidth(max_bandwidth)
+, m_num_orderings(0)
+, m_bandwidth(0)
+, m_banded(false)
+{
+  assert( m_max_bandwidth >= 0 );
+}
+
+bool BandedCholeskySolver::compute( const Eigen::SparseMatrix<scalar>& A )
+{
+  assert( A.rows() == A.cols() );
+  assert( A.rows()%2 == 0 );
+  assert( A.isCompressed() );
+
+  bool changed = patternChanged(A);
+  if( changed ) computeOrdering(A);
+
+  if( m_banded ) return factorBanded(A);
+
+  if( changed ) m_sparse.analyzePattern(A);
+  m_sparse.factorize(A);
+  return m_sparse.info() == Eigen::Success;
+}
+
+void BandedCholeskySolver::solve( const VectorXs& b, VectorXs& x )
+{
+  const int n = (int) m_perm.size();
+  assert( b.size() == n );
+
+  if( !m_banded )
+  {
+    x = m_sparse.solve(b);
+    return;
+  }
+
+  const int w = m_bandwidth + 1;
+  m_work.resize(n);
+  for( int k = 0; k < n; ++k ) m_work(k) = b(m_perm[k]);
+
+  // L y = P b
+  for( int i = 0; i < n; ++i )
+  {
+    const scalar* row = &m_band[i*w + m_bandwidth - i];
+    scalar s = m_work(i);
+    for( int j = std::max( 0, i - m_bandwidth ); j < i; ++j ) s -= row[j]*m_work(j);
+    m_work(i) = s/row[i];
+  }
+
+  // L^T z = y
+  for( int i = n - 1; i >= 0; --i )
+  {
+    m_work(i) /= m_band[i*w + m_bandwidth];
+    const scalar* row = &m_band[i*w + m_bandwidth - i];
+    for( int j = std::max( 0, i - m_bandwidth ); j < i; ++j ) m_work(j) -= row[j]*m_work(i);
+  }
+
+  x.resize(n);
+  for( int k = 0; k < n; ++k ) x(m_perm[k]) = m_work(k);
+}
+
+bool BandedCholeskySolver::isBanded() const
+{
+  return m_banded;
+}
+
+int BandedCholeskySolver::getBandwidth() const
+{
+  return m_bandwidth;
+}
+
+int BandedCholeskySolver::getNumOrderings() const
+{
+  return m_num_orderings;
+}
+
+bool BandedCholeskySolver::patternChanged( const Eigen::SparseMatrix<scalar>& A ) const
+{
+  if( (int) m_outer.size() != A.cols() + 1 ) return true;
+  if( !std::equal( m_outer.begin(), m_outer.end(), A.outerIndexPtr() ) ) return true;
+  return (int) m_inner.size() != A.nonZeros() || !std::equal( m_inner.begin(), m_inner.end(), A.innerIndexPtr() );
+}
+
+void BandedCholeskySolver::computeOrdering( const Eigen::SparseMatrix<scalar>& A )
+{
+  const int ndof = A.cols();
+  const int nparticles = ndof/2;
+  m_outer.assign( A.outerIndexPtr(), A.outerIndexPtr() + ndof + 1 );
+  m_inner.assign( A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros() );
+  ++m_num_orderings;
+
+  // Particle graph: i and j are adjacent if any of their degrees of freedom couple
+  std::vector< std::vector<int> > adjacency( nparticles );
+  for( int c = 0; c < ndof; ++c )
+  {
+    for( int e = m_outer[c]; e < m_outer[c+1]; ++e )
+    {
+      int i = m_inner[e]/2;
+      int j = c/2;
+      if( i != j ) adjacency[i].push_back(j);
+    }
+  }
+  for( int i = 0; i < nparticles; ++i )
+  {
+    std::sort( adjacency[i].begin(), adjacency[i].end() );
+    adjacency[i].erase( std::unique( adjacency[i].begin(), adjacency[i].end() ), adjacency[i].end() );
+  }
+
+  std::vector<int> particle_order;
+  reverseCuthillMcKee( adjacency, particle_order );
+
+  m_perm.resize( ndof );
+  m_inverse_perm.resize( ndof );
+  for( int k = 0; k < nparticles; ++k )
+  {
+    m_perm[2*k] = 2*particle_order[k];
+    m_perm[2*k+1] = 2*particle_order[k] + 1;
+  }
+  for( int k = 0; k < ndof; ++k ) m_inverse_perm[m_perm[k]] = k;
+
+  m_bandwidth = 0;
+  for( int c = 0; c < ndof; ++c )
+    for( int e = m_outer[c]; e < m_outer[c+1]; ++e )
+      m_bandwidth = std::max( m_bandwidth, std::abs( m_inverse_perm[m_inner[e]] - m_inverse_perm[c] ) );
+
+  m_banded = m_bandwidth <= m_max_bandwidth;
+}
+
+bool BandedCholeskySolver::factorBanded( const Eigen::SparseMatrix<scalar>& A )
+{
+  const int n = A.cols();
+  const int b = m_bandwidth;
+  const int w = b + 1;
+
+  // Scatter the lower triangle of P A P^T into the band
+  m_band.assign( (size_t) n*w, 0.0 );
+  for( int c = 0; c < n; ++c )
+  {
+    for( Eigen::SparseMatrix<scalar>::InnerIterator it( A, c ); it; ++it )
+    {
+      int i = m_inverse_perm[it.row()];
+      int j = m_inverse_perm[c];
+      if( i >= j ) m_band[i*w + b - (i-j)] = it.value();
+    }
+  }
+
+  for( int i = 0; i < n; ++i )
+  {
+    scalar* rowi = &m_band[i*w + b - i];
+    for( int j = std::max( 0, i - b ); j <= i; ++j )
+    {
+      const scalar* rowj = &m_band[j*w + b - j];
+      scalar s = rowi[j];
+      for( int k = std::max( 0, i - b ); k < j; ++k ) s -= rowi[k]*rowj[k];
+      if( j < i )
+      {
+        rowi[j] = s/rowj[j];
+      }
+      else
+      {
+        if( !( s > 0.0 ) ) return false;
+        rowi[i] = std::sqrt(s);
+      }
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,59 @@
+#ifndef __BANDED_CHOLESKY_SOLVER__
+#define __BANDED_CHOLESKY_SOLVER__
+
+#include <Eigen/Sparse>
+#include <vector>
+
+#include "MathDefs.h"
+
+// Direct solver for the sparse symmetric positive definite systems of the
+// implicit integrators (2 degrees of freedom per particle). When the sparsity
+// pattern changes, the particle graph is reordered with reverse Cuthill-McKee.
+// If the resulting bandwidth is small, as it is for chains and ribbons no
+// matter how the scene file numbers their particles, the permuted matrix is
+// factored with a dense band Cholesky in O(n*b^2). Otherwise the solver falls
+// back to a sparse LDL^T with an AMD ordering.
+class BandedCholeskySolver
+{
+public:
+  BandedCholeskySolver( int max_bandwidth = 64 );
+
+  // Returns false if the matrix is not positive definite
+  bool compute( const Eigen::SparseMatrix<scalar>& A );
+
+  void solve( const VectorXs& b, VectorXs& x );
+
+  bool isBanded() const;
+  // Bandwidth of the permuted matrix, in degrees of freedom
+  int getBandwidth() const;
+  // Number of times the ordering has been recomputed
+  int getNumOrderings() const;
+
+private:
+  bool patternChanged( const Eigen::SparseMatrix<scalar>& A ) const;
+
+  void computeOrdering( const Eigen::SparseMatrix<scalar>& A );
+
+  bool factorBanded( const Eigen::SparseMatrix<scalar>& A );
+
+  int m_max_bandwidth;
+
+  // Cached pattern of the input matrix
+  std::vector<int> m_outer;
+  std::vector<int> m_inner;
+  int m_num_orderings;
+
+  // m_perm[k] is the degree of freedom at position k, m_inverse_perm its inverse
+  std::vector<int> m_perm;
+  std::vector<int> m_inverse_perm;
+  int m_bandwidth;
+  bool m_banded;
+
+  // Band of the lower triangular factor, row major: L(i,j) is m_band[i*(b+1) + b-(i-j)]
+  std::vector<scalar> m_band;
+  VectorXs m_work;
+
+  Eigen::SimplicialLDLT< Eigen::SparseMatrix<scalar>, Eigen::Lower, Eigen::AMDOrdering<int> > m_sparse;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include "BlockJacobiPreconditioner.h"
+
+#include <cmath>
+#include <Eigen/LU>
+
+void BlockJacobiPreconditioner::compute( const Eigen::SparseMatrix<scalar>& A )
+{
+  assert( A.rows() == A.cols() );
+  assert( A.rows()%2 == 0 );
+
+  const int nblocks = A.rows()/2;
+  m_inverse_blocks.resize( nblocks );
+
+  for( int b = 0; b < nblocks; ++b )
+  {
+    Matrix2s block;
+    block << A.coeff(2*b,2*b), A.coeff(2*b,2*b+1), A.coeff(2*b+1,2*b), A.coeff(2*b+1,2*b+1);
+    scalar det = block.determinant();
+    // Fall back to scalar Jacobi on a singular block
+    if( std::fabs(det) <= 1.0e-14*block.cwiseAbs().maxCoeff()*block.cwiseAbs().maxCoeff() )
+    {
+      m_inverse_blocks[b].setZero();
+      for( int k = 0; k < 2; ++k ) m_inverse_blocks[b](k,k) = block(k,k) != 0.0 ? 1.0/block(k,k) : 1.0;
+    }
+    else
+    {
+      m_inverse_blocks[b] = block.inverse();
+    }
+  }
+}
+
+void BlockJacobiPreconditioner::apply( const VectorXs& r, VectorXs& z ) const
+{
+  assert( r.size() == 2*(int)m_inverse_blocks.size() );
+  z.resize( r.size() );
+
+  const int nblocks = (int) m_inverse_blocks.size();
+  #pragma omp parallel for schedule(static)
+  for( int b = 0; b < nblocks; ++b ) z.segment<2>(2*b) = m_inverse_blocks[b]*r.segment<2>(2*b);
+}
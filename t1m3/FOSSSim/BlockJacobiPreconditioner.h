@@ -0,0 +1,22 @@
+#ifndef __BLOCK_JACOBI_PRECONDITIONER_H__
+#define __BLOCK_JACOBI_PRECONDITIONER_H__
+
+#include <vector>
+
+#include "Preconditioner.h"
+
+// Inverts the 2x2 diagonal block belonging to each particle. Unlike scalar
+// Jacobi this captures the coupling between a particle's x and y degrees of
+// freedom, which dominates for stiff springs that are not axis aligned.
+class BlockJacobiPreconditioner : public Preconditioner
+{
+public:
+  virtual void compute( const Eigen::SparseMatrix<scalar>& A );
+
+  virtual void apply( const VectorXs& r, VectorXs& z ) const;
+
+private:
+  std::vector<Matrix2s, Eigen::aligned_allocator<Matrix2s> > m_inverse_blocks;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "ChebyshevJacobiSolver.h"
+
+#include <cmath>
+
+namespace
+{
+  const int kPowerIterations = 50;
+  // Power iteration approaches rho from below. Underestimating rho can stall
+  // the acceleration while overestimating it only costs a little speed, so the
+  // estimate is moved this fraction of the way towards 1.
+  const scalar kRhoSafety = 0.1;
+  const scalar kMaxRho = 0.9999;
+}
+
+ChebyshevJacobiSolver::ChebyshevJacobiSolver( scalar tolerance, int max_iterations )
+: m_tolerance(tolerance)
+, m_max_iterations(max_iterations)
+, m_A()
+, m_inv_diag()
+, m_rho(0.0)
+, m_num_estimates(0)
+, m_iterations(0)
+, m_residual(0.0)
+{
+  assert( m_tolerance > 0.0 );
+  assert( m_max_iterations > 0 );
+}
+
+void ChebyshevJacobiSolver::compute( const Eigen::SparseMatrix<scalar>& A )
+{
+  assert( A.rows() == A.cols() );
+
+  Eigen::SparseMatrix<scalar, Eigen::RowMajor> rowmajor( A );
+  if( m_num_estimates > 0 && rowmajor.rows() == m_A.rows() && rowmajor.nonZeros() == m_A.nonZeros() && rowmajor.isApprox( m_A, 0.0 ) ) return;
+
+  m_A.swap( rowmajor );
+  m_A.makeCompressed();
+  m_inv_diag = m_A.diagonal().cwiseInverse();
+  estimateSpectralRadius();
+}
+
+bool ChebyshevJacobiSolver::solve( const VectorXs& b, VectorXs& x )
+{
+  assert( b.size() == m_A.rows() );
+  if( x.size() != b.size() ) x.setZero( b.size() );
+
+  const scalar bnorm2 = b.squaredNorm();
+  const scalar tol2 = m_tolerance*m_tolerance*( bnorm2 > 0.0 ? bnorm2 : 1.0 );
+  const scalar rho2 = m_rho*m_rho;
+
+  m_prev = x;
+  scalar omega = 1.0;
+  m_iterations = 0;
+  scalar r2 = 0.0;
+  while( m_iterations < m_max_iterations )
+  {
+    r2 = jacobiSweep( x, b, m_next );
+    if( r2 <= tol2 ) break;
+
+    // omega_1 = 1, omega_2 = 2/(2-rho^2), omega_k+1 = 4/(4-rho^2 omega_k)
+    omega = m_iterations == 0 ? 1.0 : ( m_iterations == 1 ? 2.0/(2.0-rho2) : 4.0/(4.0-rho2*omega) );
+    m_next = omega*( m_next - m_prev ) + m_prev;
+    m_prev.swap( x );
+    x.swap( m_next );
+    ++m_iterations;
+  }
+
+  m_residual = std::sqrt( r2/( bnorm2 > 0.0 ? bnorm2 : 1.0 ) );
+  return r2 <= tol2;
+}
+
+void ChebyshevJacobiSolver::setSpectralRadius( scalar rho )
+{
+  assert( rho >= 0.0 && rho < 1.0 );
+  m_rho = rho;
+}
+
+scalar ChebyshevJacobiSolver::getSpectralRadius() const
+{
+  return m_rho;
+}
+
+int ChebyshevJacobiSolver::getNumIterations() const
+{
+  return m_iterations;
+}
+
+scalar ChebyshevJacobiSolver::getRelativeResidual() const
+{
+  return m_residual;
+}
+
+int ChebyshevJacobiSolver::getNumEstimates() const
+{
+  return m_num_estimates;
+}
+
+void ChebyshevJacobiSolver::estimateSpectralRadius()
+{
+  const int n = m_A.rows();
+  ++m_num_estimates;
+  m_rho = 0.0;
+  if( n == 0 ) return;
+
+  // Power iteration on G = I - D^-1 A, i.e. a Jacobi sweep with b = 0. The
+  // start vector mixes smooth and oscillatory components.
+  VectorXs zero = VectorXs::Zero(n);
+  VectorXs u(n);
+  for( int i = 0; i < n; ++i ) u(i) = 1.0 + ( i%2 == 0 ? 0.5 : -0.5 ) + scalar(i%7)/7.0;
+  u.normalize();
+
+  scalar rho = 0.0;
+  for( int k = 0; k < kPowerIterations; ++k )
+  {
+    jacobiSweep( u, zero, m_next );
+    rho = m_next.norm();
+    if( rho == 0.0 ) break;
+    u = m_next/rho;
+  }
+
+  m_rho = std::min( kMaxRho, rho + kRhoSafety*( 1.0 - rho ) );
+}
+
+scalar ChebyshevJacobiSolver::jacobiSweep( const VectorXs& x, const VectorXs& b, VectorXs& out ) const
+{
+  const int n = m_A.rows();
+  out.resize(n);
+  scalar r2 = 0.0;
+
+  #pragma omp parallel for schedule(static) reduction(+:r2)
+  for( int i = 0; i < n; ++i )
+  {
+    scalar ri = b(i);
+    for( Eigen::SparseMatrix<scalar, Eigen::RowMajor>::InnerIterator it( m_A, i ); it; ++it ) ri -= it.value()*x(it.col());
+    out(i) = x(i) + m_inv_diag(i)*ri;
+    r2 += ri*ri;
+  }
+
+  return r2;
+}
@@ -25,6 +25,8 @@ public:
   
   virtual Force* createNewCopy();
 
+  const scalar& getB() const { return m_b; }
+
 private:
   scalar m_b;
 };
@@ -23,6 +23,9 @@ public:
 
   virtual Force* createNewCopy();
 
+  const std::pair<int,int>& getParticles() const { return m_particles; }
+  const scalar& getG() const { return m_G; }
+
 private:
   std::pair<int,int> m_particles;
   // Gravitational constant
@@ -0,0 +1,249 @@
+#include "ImplicitSystemAssembler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SpringForce.h"
+#include "DragDampingForce.h"
+#include "GravitationalForce.h"
+#include "SimpleGravityForce.h"
+
+ImplicitSystemAssembler::ImplicitSystemAssembler()
+: m_cached_forces()
+, m_cached_fixed()
+, m_pattern_valid(false)
+, m_pattern_version(0)
+{}
+
+int ImplicitSystemAssembler::getPatternVersion() const
+{
+  return m_pattern_version;
+}
+
+void ImplicitSystemAssembler::assemble( const TwoDScene& scene, const VectorXs& x, const VectorXs& v, scalar cx, scalar cv, Eigen::SparseMatrix<scalar>& A )
+{
+  const int ndof = x.size();
+  assert( ndof == v.size() );
+  assert( ndof == scene.getM().size() );
+
+  if( A.rows() != ndof || A.cols() != ndof || topologyChanged( scene ) ) buildPattern( scene, x, v, A );
+
+  const VectorXs& m = scene.getM();
+  scalar* values = A.valuePtr();
+  std::fill( values, values + A.nonZeros(), 0.0 );
+
+  // Mass matrix, identity on fixed degrees of freedom
+  for( int d = 0; d < ndof; ++d ) values[m_diagonal_slots[d]] = scene.isFixed(d/2) ? 1.0 : m(d);
+
+  for( std::vector<const Force*>::size_type f = 0; f < m_pair_forces.size(); ++f )
+  {
+    const int* slots = &m_pair_slots[16*f];
+    if( const SpringForce* spring = dynamic_cast<const SpringForce*>( m_pair_forces[f] ) )
+    {
+      int i = spring->getEndpoints().first;
+      int j = spring->getEndpoints().second;
+      Vector2s n = x.segment<2>(2*i) - x.segment<2>(2*j);
+      scalar l = n.norm();
+      if( l == 0.0 ) continue;
+      n /= l;
+      Matrix2s nnT = n*n.transpose();
+      Matrix2s K = cx*spring->getK()*( nnT + ( 1.0 - spring->getL0()/l )*( Matrix2s::Identity() - nnT ) ) + cv*spring->getB()*nnT;
+      addPairBlock( values, slots, K );
+    }
+    else if( const GravitationalForce* gravity = dynamic_cast<const GravitationalForce*>( m_pair_forces[f] ) )
+    {
+      int i = gravity->getParticles().first;
+      int j = gravity->getParticles().second;
+      Vector2s d = x.segment<2>(2*i) - x.segment<2>(2*j);
+      scalar r = d.norm();
+      if( r == 0.0 ) continue;
+      scalar r3 = r*r*r;
+      Matrix2s K = cx*gravity->getG()*m(2*i)*m(2*j)*( Matrix2s::Identity()/r3 - 3.0*d*d.transpose()/(r3*r*r) );
+      addPairBlock( values, slots, K );
+    }
+  }
+
+  for( std::vector<scalar>::size_type f = 0; f < m_drag_coefficients.size(); ++f )
+    for( int d = 0; d < ndof; ++d ) if( !scene.isFixed(d/2) ) values[m_diagonal_slots[d]] += cv*m_drag_coefficients[f];
+
+  // Unknown forces go through their dense Hessians, scattered into the
+  // entries buildPattern probed for them
+  bool pattern_grew = false;
+  for( int pass = 0; pass < 2 && !m_unknown_forces.empty(); ++pass )
+  {
+    m_dense_hessian.setZero( ndof, ndof );
+    for( std::vector<Force*>::size_type f = 0; f < m_unknown_forces.size(); ++f )
+    {
+      if( pass == 0 ) m_unknown_forces[f]->addHessXToTotal( x, v, m, m_dense_hessian );
+      else m_unknown_forces[f]->addHessVToTotal( x, v, m, m_dense_hessian );
+    }
+    scalar c = pass == 0 ? cx : cv;
+    for( std::vector<int>::size_type e = 0; e < m_unknown_slots.size(); ++e )
+    {
+      int row = m_unknown_entries[e].first;
+      int col = m_unknown_entries[e].second;
+      if( m_unknown_slots[e] >= 0 ) values[m_unknown_slots[e]] += c*m_dense_hessian(row,col);
+      m_dense_hessian(row,col) = 0.0;
+    }
+    pattern_grew = pattern_grew || hasFreeNonzeros( scene, m_dense_hessian );
+  }
+
+  // An entry that was zero when the pattern was probed has since become
+  // nonzero. Rebuilding probes it in, and it stays for as long as the forces
+  // do, so this happens at most once per new entry.
+  if( pattern_grew )
+  {
+    m_pattern_valid = false;
+    assemble( scene, x, v, cx, cv, A );
+  }
+}
+
+bool ImplicitSystemAssembler::topologyChanged( const TwoDScene& scene ) const
+{
+  if( !m_pattern_valid || scene.getForces() != m_cached_forces ) return true;
+  if( (int) m_cached_fixed.size() != scene.getNumParticles() ) return true;
+  for( int i = 0; i < scene.getNumParticles(); ++i ) if( scene.isFixed(i) != m_cached_fixed[i] ) return true;
+  return false;
+}
+
+void ImplicitSystemAssembler::buildPattern( const TwoDScene& scene, const VectorXs& x, const VectorXs& v, Eigen::SparseMatrix<scalar>& A )
+{
+  const int nparticles = scene.getNumParticles();
+  const int ndof = 2*nparticles;
+
+  if( scene.getForces() != m_cached_forces || (int) m_cached_fixed.size() != nparticles ) m_unknown_entries.clear();
+  m_cached_forces = scene.getForces();
+  m_cached_fixed.resize( nparticles );
+  for( int i = 0; i < nparticles; ++i ) m_cached_fixed[i] = scene.isFixed(i);
+
+  m_pair_forces.clear();
+  m_drag_coefficients.clear();
+  m_unknown_forces.clear();
+
+  std::vector< std::pair<int,int> > pairs;
+  for( std::vector<Force*>::size_type f = 0; f < m_cached_forces.size(); ++f )
+  {
+    const Force* force = m_cached_forces[f];
+    if( const SpringForce* spring = dynamic_cast<const SpringForce*>( force ) )
+    {
+      m_pair_forces.push_back( force );
+      pairs.push_back( spring->getEndpoints() );
+    }
+    else if( const GravitationalForce* gravity = dynamic_cast<const GravitationalForce*>( force ) )
+    {
+      m_pair_forces.push_back( force );
+      pairs.push_back( gravity->getParticles() );
+    }
+    else if( const DragDampingForce* drag = dynamic_cast<const DragDampingForce*>( force ) )
+    {
+      m_drag_coefficients.push_back( drag->getB() );
+    }
+    else if( dynamic_cast<const SimpleGravityForce*>( force ) == NULL )
+    {
+      m_unknown_forces.push_back( m_cached_forces[f] );
+    }
+  }
+
+  // Unknown forces only expose dense Hessians, so their entries are probed at
+  // the current state and added to those found by earlier probes
+  if( !m_unknown_forces.empty() )
+  {
+    const VectorXs& m = scene.getM();
+    m_dense_hessian.setZero( ndof, ndof );
+    for( std::vector<Force*>::size_type f = 0; f < m_unknown_forces.size(); ++f )
+    {
+      m_unknown_forces[f]->addHessXToTotal( x, v, m, m_dense_hessian );
+      m_unknown_forces[f]->addHessVToTotal( x, v, m, m_dense_hessian );
+    }
+    for( int col = 0; col < ndof; ++col ) for( int row = 0; row < ndof; ++row )
+      if( m_dense_hessian(row,col) != 0.0 ) m_unknown_entries.push_back( std::make_pair( row, col ) );
+    std::sort( m_unknown_entries.begin(), m_unknown_entries.end() );
+    m_unknown_entries.erase( std::unique( m_unknown_entries.begin(), m_unknown_entries.end() ), m_unknown_entries.end() );
+  }
+
+  // Full 2x2 diagonal blocks, plus the four blocks coupling each pair
+  std::vector< Eigen::Triplet<scalar> > triplets;
+  triplets.reserve( 4*nparticles + 16*pairs.size() + m_unknown_entries.size() );
+  for( int i = 0; i < nparticles; ++i )
+  {
+    for( int r = 0; r < 2; ++r ) for( int c = 0; c < 2; ++c )
+      if( r == c || !scene.isFixed(i) ) triplets.push_back( Eigen::Triplet<scalar>( 2*i+r, 2*i+c, 0.0 ) );
+  }
+  for( std::vector< std::pair<int,int> >::size_type p = 0; p < pairs.size(); ++p )
+  {
+    int i = pairs[p].first;
+    int j = pairs[p].second;
+    if( scene.isFixed(i) || scene.isFixed(j) ) continue;
+    for( int r = 0; r < 2; ++r ) for( int c = 0; c < 2; ++c )
+    {
+      triplets.push_back( Eigen::Triplet<scalar>( 2*i+r, 2*j+c, 0.0 ) );
+      triplets.push_back( Eigen::Triplet<scalar>( 2*j+r, 2*i+c, 0.0 ) );
+    }
+  }
+
+  for( std::vector< std::pair<int,int> >::size_type e = 0; e < m_unknown_entries.size(); ++e )
+  {
+    int row = m_unknown_entries[e].first;
+    int col = m_unknown_entries[e].second;
+    if( !scene.isFixed(row/2) && !scene.isFixed(col/2) ) triplets.push_back( Eigen::Triplet<scalar>( row, col, 0.0 ) );
+  }
+
+  A.resize( ndof, ndof );
+  A.setFromTriplets( triplets.begin(), triplets.end() );
+  A.makeCompressed();
+  m_pattern_valid = true;
+  ++m_pattern_version;
+
+  m_diagonal_slots.resize( ndof );
+  for( int d = 0; d < ndof; ++d ) m_diagonal_slots[d] = &A.coeffRef(d,d) - A.valuePtr();
+
+  m_pair_slots.resize( 16*pairs.size() );
+  for( std::vector< std::pair<int,int> >::size_type p = 0; p < pairs.size(); ++p )
+  {
+    int i = pairs[p].first;
+    int j = pairs[p].second;
+    int* slots = &m_pair_slots[16*p];
+    blockSlots( scene, A, i, i, slots );
+    blockSlots( scene, A, j, j, slots + 4 );
+    blockSlots( scene, A, i, j, slots + 8 );
+    blockSlots( scene, A, j, i, slots + 12 );
+  }
+
+  m_unknown_slots.resize( m_unknown_entries.size() );
+  for( std::vector< std::pair<int,int> >::size_type e = 0; e < m_unknown_entries.size(); ++e )
+  {
+    int row = m_unknown_entries[e].first;
+    int col = m_unknown_entries[e].second;
+    bool skip = scene.isFixed(row/2) || scene.isFixed(col/2);
+    m_unknown_slots[e] = skip ? -1 : int( &A.coeffRef(row,col) - A.valuePtr() );
+  }
+}
+
+bool ImplicitSystemAssembler::hasFreeNonzeros( const TwoDScene& scene, const MatrixXs& H ) const
+{
+  for( int col = 0; col < H.cols(); ++col )
+  {
+    if( scene.isFixed(col/2) ) continue;
+    for( int row = 0; row < H.rows(); ++row ) if( H(row,col) != 0.0 && !scene.isFixed(row/2) ) return true;
+  }
+  return false;
+}
+
+void ImplicitSystemAssembler::blockSlots( const TwoDScene& scene, Eigen::SparseMatrix<scalar>& A, int i, int j, int* slots ) const
+{
+  bool skip = scene.isFixed(i) || scene.isFixed(j);
+  for( int r = 0; r < 2; ++r ) for( int c = 0; c < 2; ++c )
+    slots[2*r+c] = skip ? -1 : int( &A.coeffRef(2*i+r,2*j+c) - A.valuePtr() );
+}
+
+void ImplicitSystemAssembler::addPairBlock( scalar* values, const int* slots, const Matrix2s& K ) const
+{
+  for( int e = 0; e < 4; ++e )
+  {
+    scalar k = K(e/2,e%2);
+    if( slots[e] >= 0 ) values[slots[e]] += k;
+    if( slots[4+e] >= 0 ) values[slots[4+e]] += k;
+    if( slots[8+e] >= 0 ) values[slots[8+e]] -= k;
+    if( slots[12+e] >= 0 ) values[slots[12+e]] -= k;
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef __IMPLICIT_SYSTEM_ASSEMBLER__
+#define __IMPLICIT_SYSTEM_ASSEMBLER__
+
+#include <Eigen/Sparse>
+#include <vector>
+
+#include "TwoDScene.h"
+#include "MathDefs.h"
+
+// Assembles the sparse implicit system matrix
+//
+//   A = M + cx*d2E/dxdx + cv*d2E/dvdv
+//
+// (e.g. cx = dt^2, cv = dt for linearized implicit Euler), with the rows and
+// columns of fixed degrees of freedom replaced by the identity. The Hessians
+// of the known force types (SpringForce, DragDampingForce,
+// GravitationalForce, SimpleGravityForce) are written directly into the
+// matrix: the sparsity pattern and the position of every 2x2 block in the
+// value array are computed once per topology, so later calls only overwrite
+// values. Any other force falls back to its dense addHess*ToTotal methods;
+// its nonzeros are probed when the pattern is built, and an entry that only
+// becomes nonzero later is added by a single rebuild.
+//
+// The spring damping term's position derivative is not symmetric and is
+// omitted, so the assembled matrix is symmetric. It is not always positive
+// definite: a compressed spring's (1 - l0/l) term and gravitational
+// attraction both have negative stiffness, and the matrix is only positive
+// definite while M outweighs them, as it does for the scenes' time steps. The
+// same matrix object should be passed to every call, since the cached offsets
+// refer to its value array.
+class ImplicitSystemAssembler
+{
+public:
+  ImplicitSystemAssembler();
+
+  void assemble( const TwoDScene& scene, const VectorXs& x, const VectorXs& v, scalar cx, scalar cv, Eigen::SparseMatrix<scalar>& A );
+
+  // Incremented whenever the sparsity pattern of the assembled matrix changes
+  int getPatternVersion() const;
+
+private:
+  bool topologyChanged( const TwoDScene& scene ) const;
+
+  void buildPattern( const TwoDScene& scene, const VectorXs& x, const VectorXs& v, Eigen::SparseMatrix<scalar>& A );
+
+  // True if H has a nonzero outside the rows and columns of fixed particles
+  bool hasFreeNonzeros( const TwoDScene& scene, const MatrixXs& H ) const;
+
+  // Offsets of the four entries of block (i,j) in A's value array, -1 for entries in fixed rows or columns
+  void blockSlots( const TwoDScene& scene, Eigen::SparseMatrix<scalar>& A, int i, int j, int* slots ) const;
+
+  // Adds s*K to blocks (i,i) and (j,j) and -s*K to (i,j) and (j,i)
+  void addPairBlock( scalar* values, const int* slots, const Matrix2s& K ) const;
+
+  std::vector<Force*> m_cached_forces;
+  std::vector<bool> m_cached_fixed;
+  bool m_pattern_valid;
+  int m_pattern_version;
+
+  // Known forces and the value array offsets they write to (16 per pair force, 8 per drag particle)
+  std::vector<const Force*> m_pair_forces;
+  std::vector<int> m_pair_slots;
+  std::vector<scalar> m_drag_coefficients;
+  std::vector<int> m_diagonal_slots;
+  std::vector<Force*> m_unknown_forces;
+
+  // Every entry the unknown forces' Hessians were seen to touch while the
+  // forces stayed the same, and its value array offset (-1 if fixed)
+  std::vector< std::pair<int,int> > m_unknown_entries;
+  std::vector<int> m_unknown_slots;
+
+  MatrixXs m_dense_hessian;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "IncompleteCholeskyPreconditioner.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // The first retry shifts the diagonal by 1e-3*diag(A), and every further
+  // one doubles the shift; the last attempt adds about 500*diag(A)
+  const int kMaxShiftRetries = 20;
+}
+
+IncompleteCholeskyPreconditioner::IncompleteCholeskyPreconditioner()
+: m_shift(0.0)
+, m_use_fallback(false)
+{}
+
+void IncompleteCholeskyPreconditioner::compute( const Eigen::SparseMatrix<scalar>& A )
+{
+  assert( A.rows() == A.cols() );
+  assert( A.isCompressed() );
+
+  if( patternChanged(A) ) analyzePattern(A);
+
+  m_shift = 0.0;
+  m_use_fallback = !factor( A, m_shift );
+  for( int retry = 0; retry < kMaxShiftRetries && m_use_fallback; ++retry )
+  {
+    m_shift = m_shift == 0.0 ? 1.0e-3 : 2.0*m_shift;
+    m_use_fallback = !factor( A, m_shift );
+  }
+
+  if( m_use_fallback ) m_fallback.compute(A);
+}
+
+void IncompleteCholeskyPreconditioner::apply( const VectorXs& r, VectorXs& z ) const
+{
+  if( m_use_fallback )
+  {
+    m_fallback.apply( r, z );
+    return;
+  }
+
+  const int n = m_L.cols();
+  assert( r.size() == n );
+  const int* outer = m_L.outerIndexPtr();
+  const int* inner = m_L.innerIndexPtr();
+  const scalar* values = m_L.valuePtr();
+
+  // L y = r
+  z = r;
+  for( int k = 0; k < n; ++k )
+  {
+    z(k) /= values[outer[k]];
+    for( int e = outer[k] + 1; e < outer[k+1]; ++e ) z(inner[e]) -= values[e]*z(k);
+  }
+
+  // L^T z = y
+  for( int k = n - 1; k >= 0; --k )
+  {
+    scalar s = z(k);
+    for( int e = outer[k] + 1; e < outer[k+1]; ++e ) s -= values[e]*z(inner[e]);
+    z(k) = s/values[outer[k]];
+  }
+}
+
+scalar IncompleteCholeskyPreconditioner::getShift() const
+{
+  return m_shift;
+}
+
+bool IncompleteCholeskyPreconditioner::usesFallback() const
+{
+  return m_use_fallback;
+}
+
+bool IncompleteCholeskyPreconditioner::patternChanged( const Eigen::SparseMatrix<scalar>& A ) const
+{
+  if( (int) m_outer.size() != A.cols() + 1 ) return true;
+  if( !std::equal( m_outer.begin(), m_outer.end(), A.outerIndexPtr() ) ) return true;
+  return (int) m_inner.size() != A.nonZeros() || !std::equal( m_inner.begin(), m_inner.end(), A.innerIndexPtr() );
+}
+
+void IncompleteCholeskyPreconditioner::analyzePattern( const Eigen::SparseMatrix<scalar>& A )
+{
+  const int n = A.cols();
+  m_outer.assign( A.outerIndexPtr(), A.outerIndexPtr() + n + 1 );
+  m_inner.assign( A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros() );
+
+  // Lower triangle of A's pattern. Row indices are sorted, so each column's diagonal comes first.
+  std::vector< Eigen::Triplet<scalar> > triplets;
+  for( int k = 0; k < n; ++k )
+  {
+    bool has_diagonal = false;
+    for( int e = m_outer[k]; e < m_outer[k+1]; ++e )
+    {
+      if( m_inner[e] < k ) continue;
+      has_diagonal = has_diagonal || m_inner[e] == k;
+      triplets.push_back( Eigen::Triplet<scalar>( m_inner[e], k, 0.0 ) );
+    }
+    assert( has_diagonal );
+  }
+  m_L.resize( n, n );
+  m_L.setFromTriplets( triplets.begin(), triplets.end() );
+  m_L.makeCompressed();
+
+  const int* outer = m_L.outerIndexPtr();
+  const int* inner = m_L.innerIndexPtr();
+
+  m_source.resize( m_L.nonZeros() );
+  for( int k = 0; k < n; ++k )
+  {
+    int src = m_outer[k];
+    for( int e = outer[k]; e < outer[k+1]; ++e )
+    {
+      while( m_inner[src] != inner[e] ) ++src;
+      m_source[e] = src;
+    }
+  }
+
+  // Updates L(i,j) -= L(i,k)*L(j,k) for i >= j > k, kept only where L(i,j) is in the pattern
+  m_update_starts.assign( n + 1, 0 );
+  m_updates.clear();
+  for( int k = 0; k < n; ++k )
+  {
+    m_update_starts[k] = (int) m_updates.size() / 3;
+    for( int ej = outer[k] + 1; ej < outer[k+1]; ++ej )
+    {
+      int j = inner[ej];
+      for( int ei = ej; ei < outer[k+1]; ++ei )
+      {
+        int i = inner[ei];
+        const int* begin = inner + outer[j];
+        const int* end = inner + outer[j+1];
+        const int* found = std::lower_bound( begin, end, i );
+        if( found == end || *found != i ) continue;
+        m_updates.push_back( int( found - inner ) );
+        m_updates.push_back( ei );
+        m_updates.push_back( ej );
+      }
+    }
+  }
+  m_update_starts[n] = (int) m_updates.size() / 3;
+}
+
+bool IncompleteCholeskyPreconditioner::factor( const Eigen::SparseMatrix<scalar>& A, scalar shift )
+{
+  const int n = m_L.cols();
+  const int* outer = m_L.outerIndexPtr();
+  scalar* values = m_L.valuePtr();
+  const scalar* avalues = A.valuePtr();
+
+  for( int e = 0; e < m_L.nonZeros(); ++e ) values[e] = avalues[m_source[e]];
+  if( shift != 0.0 ) for( int k = 0; k < n; ++k ) values[outer[k]] *= 1.0 + shift;
+
+  for( int k = 0; k < n; ++k )
+  {
+    scalar d = values[outer[k]];
+    if( !( d > 0.0 ) ) return false;
+    d = std::sqrt(d);
+    values[outer[k]] = d;
+    for( int e = outer[k] + 1; e < outer[k+1]; ++e ) values[e] /= d;
+
+    for( int u = m_update_starts[k]; u < m_update_starts[k+1]; ++u )
+      values[m_updates[3*u]] -= values[m_updates[3*u+1]]*values[m_updates[3*u+2]];
+  }
+
+  return true;
+}
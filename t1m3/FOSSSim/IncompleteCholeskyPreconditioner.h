@@ -0,0 +1,59 @@
+#ifndef __INCOMPLETE_CHOLESKY_PRECONDITIONER_H__
+#define __INCOMPLETE_CHOLESKY_PRECONDITIONER_H__
+
+#include <vector>
+
+#include "Preconditioner.h"
+#include "BlockJacobiPreconditioner.h"
+
+// Zero fill-in incomplete Cholesky factorization, A ~ L L^T, with L restricted
+// to the sparsity pattern of A's lower triangle. The pattern and the index
+// lookups the factorization needs are cached and only rebuilt when A's
+// pattern changes, so refactoring after a value update is purely numeric.
+// If a pivot breaks down the diagonal is shifted (A + alpha*diag(A)) and the
+// factorization retried with a doubled shift. If that keeps failing, which a
+// NaN or infinite entry guarantees, the preconditioner falls back to block
+// Jacobi.
+class IncompleteCholeskyPreconditioner : public Preconditioner
+{
+public:
+  IncompleteCholeskyPreconditioner();
+
+  virtual void compute( const Eigen::SparseMatrix<scalar>& A );
+
+  virtual void apply( const VectorXs& r, VectorXs& z ) const;
+
+  // Diagonal shift used by the last factorization (0 if none was needed)
+  scalar getShift() const;
+
+  // Whether the last compute() gave up on the factorization and apply() is
+  // using block Jacobi instead
+  bool usesFallback() const;
+
+private:
+  bool patternChanged( const Eigen::SparseMatrix<scalar>& A ) const;
+
+  void analyzePattern( const Eigen::SparseMatrix<scalar>& A );
+
+  bool factor( const Eigen::SparseMatrix<scalar>& A, scalar shift );
+
+  // Cached pattern of the input matrix
+  std::vector<int> m_outer;
+  std::vector<int> m_inner;
+
+  // Lower triangle of A, column compressed. m_diag[k] is the offset of L(k,k)
+  // (always the first entry of its column) and m_source[e] the offset of
+  // L's entry e in A's value array.
+  Eigen::SparseMatrix<scalar> m_L;
+  std::vector<int> m_source;
+  // For every (i,j) update L(i,j) -= L(i,k)*L(j,k): offsets of L(i,j), L(i,k), L(j,k), grouped by k
+  std::vector<int> m_update_starts;
+  std::vector<int> m_updates;
+
+  scalar m_shift;
+
+  bool m_use_fallback;
+  BlockJacobiPreconditioner m_fallback;
+};
+
+#endif
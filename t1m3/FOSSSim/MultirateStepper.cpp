@@ -0,0 +1,181 @@
+#include "MultirateStepper.h"
+
+#include <cmath>
+
+MultirateStepper::MultirateStepper( const scalar& stability_fraction, const std::string& stiff_tag )
+: SceneStepper()
+, m_stability_fraction(stability_fraction)
+, m_stiff_tag(stiff_tag)
+, m_cached_forces()
+, m_cached_fixed()
+, m_cached_tags()
+, m_cached_m()
+, m_cached_dt(-1.0)
+, m_fast_forces()
+, m_slow_forces()
+, m_num_substeps(1)
+, m_gradE()
+, m_num_force_evaluations(0)
+{
+  assert( m_stability_fraction > 0.0 );
+}
+
+MultirateStepper::~MultirateStepper()
+{}
+
+bool MultirateStepper::stepScene( TwoDScene& scene, scalar dt )
+{
+  assert( scene.getX().size() == scene.getV().size() );
+  assert( scene.getX().size() == scene.getM().size() );
+
+  if( partitionChanged( scene, dt ) ) partitionForces( scene, dt );
+
+  const scalar h = dt/scalar(m_num_substeps);
+
+  // Slow half kick
+  kick( scene, m_slow_forces, 0.5*dt );
+
+  // Velocity Verlet on the fast forces. Adjacent half kicks between substeps
+  // could be merged, but keeping them separate keeps x and v in sync at every
+  // substep, which the velocity dependent damping terms rely on.
+  for( int i = 0; i < m_num_substeps; ++i )
+  {
+    kick( scene, m_fast_forces, 0.5*h );
+    drift( scene, h );
+    kick( scene, m_fast_forces, 0.5*h );
+  }
+
+  // Slow half kick at the synchronization point
+  kick( scene, m_slow_forces, 0.5*dt );
+
+  return true;
+}
+
+std::string MultirateStepper::getName() const
+{
+  return "Multirate Velocity Verlet";
+}
+
+int MultirateStepper::getNumSubsteps() const
+{
+  return m_num_substeps;
+}
+
+const std::vector<Force*>& MultirateStepper::getFastForces() const
+{
+  return m_fast_forces;
+}
+
+const std::vector<Force*>& MultirateStepper::getSlowForces() const
+{
+  return m_slow_forces;
+}
+
+long MultirateStepper::getNumForceEvaluations() const
+{
+  return m_num_force_evaluations;
+}
+
+bool MultirateStepper::partitionChanged( const TwoDScene& scene, scalar dt ) const
+{
+  if( dt != m_cached_dt ) return true;
+  if( scene.getForces() != m_cached_forces ) return true;
+  if( scene.getM().size() != m_cached_m.size() || scene.getM() != m_cached_m ) return true;
+  for( int i = 0; i < scene.getNumParticles(); ++i ) if( scene.isFixed(i) != m_cached_fixed[i] ) return true;
+  if( scene.getParticleTags() != m_cached_tags ) return true;
+  return false;
+}
+
+void MultirateStepper::partitionForces( const TwoDScene& scene, scalar dt )
+{
+  const int nparticles = scene.getNumParticles();
+  m_cached_forces = scene.getForces();
+  m_cached_m = scene.getM();
+  m_cached_fixed.resize( nparticles );
+  for( int i = 0; i < nparticles; ++i ) m_cached_fixed[i] = scene.isFixed(i);
+  m_cached_tags = scene.getParticleTags();
+  m_cached_dt = dt;
+  m_fast_forces.clear();
+  m_slow_forces.clear();
+
+  scalar max_fast_rate = 0.0;
+  for( std::vector<Force*>::size_type i = 0; i < m_cached_forces.size(); ++i )
+  {
+    const SpringForce* spring = dynamic_cast<const SpringForce*>( m_cached_forces[i] );
+    if( spring == NULL )
+    {
+      m_slow_forces.push_back( m_cached_forces[i] );
+      continue;
+    }
+
+    scalar rate = springRate( scene, *spring );
+    bool tagged = isTagged( scene, spring->getEndpoints().first ) || isTagged( scene, spring->getEndpoints().second );
+    if( rate > 0.0 && ( tagged || dt*rate > m_stability_fraction ) )
+    {
+      m_fast_forces.push_back( m_cached_forces[i] );
+      max_fast_rate = std::max( max_fast_rate, rate );
+    }
+    else
+    {
+      m_slow_forces.push_back( m_cached_forces[i] );
+    }
+  }
+
+  m_num_substeps = std::max( 1, (int) std::ceil( dt*max_fast_rate/m_stability_fraction ) );
+}
+
+scalar MultirateStepper::springRate( const TwoDScene& scene, const SpringForce& spring ) const
+{
+  int i = spring.getEndpoints().first;
+  int j = spring.getEndpoints().second;
+  bool ifixed = scene.isFixed(i);
+  bool jfixed = scene.isFixed(j);
+  if( ifixed && jfixed ) return 0.0;
+
+  const VectorXs& m = scene.getM();
+  scalar mi = m(2*i);
+  scalar mj = m(2*j);
+  // Effective (reduced) mass of the two-body oscillator; a fixed endpoint acts as infinite mass
+  scalar meff = ifixed ? mj : ( jfixed ? mi : mi*mj/(mi+mj) );
+  assert( meff > 0.0 );
+
+  return std::sqrt( spring.getK()/meff ) + spring.getB()/meff;
+}
+
+bool MultirateStepper::isTagged( const TwoDScene& scene, int particle ) const
+{
+  const std::vector<std::string>& tags = scene.getParticleTags();
+  return particle < (int) tags.size() && tags[particle] == m_stiff_tag;
+}
+
+void MultirateStepper::kick( TwoDScene& scene, const std::vector<Force*>& forces, scalar h )
+{
+  if( forces.empty() ) return;
+
+  const VectorXs& x = scene.getX();
+  VectorXs& v = scene.getV();
+  const VectorXs& m = scene.getM();
+
+  m_gradE.setZero( x.size() );
+  for( std::vector<Force*>::size_type i = 0; i < forces.size(); ++i )
+    forces[i]->addGradEToTotal( x, v, m, m_gradE );
+  m_num_force_evaluations += forces.size();
+
+  for( int i = 0; i < scene.getNumParticles(); ++i )
+  {
+    if( scene.isFixed(i) ) continue;
+    v.segment<2>(2*i) -= h*m_gradE.segment<2>(2*i).cwiseQuotient( m.segment<2>(2*i) );
+  }
+}
+
+void MultirateStepper::drift( TwoDScene& scene, scalar h )
+{
+  VectorXs& x = scene.getX();
+  const VectorXs& v = scene.getV();
+
+  for( int i = 0; i < scene.getNumParticles(); ++i )
+  {
+    if( scene.isFixed(i) ) continue;
+    x.segment<2>(2*i) += h*v.segment<2>(2*i);
+  }
+}
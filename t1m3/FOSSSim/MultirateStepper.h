@@ -0,0 +1,76 @@
+#ifndef __MULTIRATE_STEPPER__
+#define __MULTIRATE_STEPPER__
+
+#include <Eigen/Dense>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "SceneStepper.h"
+#include "SpringForce.h"
+
+// Impulse-style multirate (r-RESPA) integrator. Forces are partitioned into a
+// 'fast' set of stiff springs and a 'slow' set containing everything else. The
+// slow forces kick the velocities by half a step at either end of the step,
+// while the fast forces are integrated with velocity Verlet over several
+// substeps in between. A spring is considered stiff if dt*(sqrt(k/m)+b/m)
+// exceeds the stability fraction, or if either endpoint carries the stiff tag
+// in TwoDScene::getParticleTags(). Velocity Verlet is stable for dt*omega < 2;
+// the default fraction of 0.5 also keeps the phase error of the fast
+// oscillators small.
+class MultirateStepper : public SceneStepper
+{
+public:
+  MultirateStepper( const scalar& stability_fraction = 0.5, const std::string& stiff_tag = "stiff" );
+  
+  virtual ~MultirateStepper();
+  
+  virtual bool stepScene( TwoDScene& scene, scalar dt );
+  
+  virtual std::string getName() const;
+
+  // Number of fast substeps taken per call to stepScene (1 if nothing is stiff).
+  int getNumSubsteps() const;
+
+  const std::vector<Force*>& getFastForces() const;
+  const std::vector<Force*>& getSlowForces() const;
+
+  // Total number of Force::addGradEToTotal calls made so far.
+  long getNumForceEvaluations() const;
+
+private:
+  // True if anything the partition depends on changed since it was built:
+  // dt, the forces, the masses, the fixed flags or the particle tags
+  bool partitionChanged( const TwoDScene& scene, scalar dt ) const;
+
+  void partitionForces( const TwoDScene& scene, scalar dt );
+
+  // Frequency estimate (1/time) for a spring; zero if both endpoints are fixed.
+  scalar springRate( const TwoDScene& scene, const SpringForce& spring ) const;
+
+  bool isTagged( const TwoDScene& scene, int particle ) const;
+
+  // v += h*F/m for the given forces, skipping fixed particles
+  void kick( TwoDScene& scene, const std::vector<Force*>& forces, scalar h );
+
+  // x += h*v, skipping fixed particles
+  void drift( TwoDScene& scene, scalar h );
+
+  scalar m_stability_fraction;
+  std::string m_stiff_tag;
+
+  // Partition cache, rebuilt only when partitionChanged
+  std::vector<Force*> m_cached_forces;
+  std::vector<bool> m_cached_fixed;
+  std::vector<std::string> m_cached_tags;
+  VectorXs m_cached_m;
+  scalar m_cached_dt;
+  std::vector<Force*> m_fast_forces;
+  std::vector<Force*> m_slow_forces;
+  int m_num_substeps;
+
+  VectorXs m_gradE;
+  long m_num_force_evaluations;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "PreconditionedCGSolver.h"
+
+#include <cmath>
+
+PreconditionedCGSolver::PreconditionedCGSolver( PreconditionerType type, scalar tolerance, int max_iterations )
+: m_type(type)
+, m_tolerance(tolerance)
+, m_max_iterations(max_iterations)
+, m_A(NULL)
+, m_iterations(0)
+, m_residual(0.0)
+{
+  assert( m_tolerance > 0.0 );
+  assert( m_max_iterations > 0 );
+}
+
+void PreconditionedCGSolver::setPreconditioner( PreconditionerType type )
+{
+  m_type = type;
+  if( m_A != NULL ) compute( *m_A );
+}
+
+PreconditionedCGSolver::PreconditionerType PreconditionedCGSolver::getPreconditioner() const
+{
+  return m_type;
+}
+
+void PreconditionedCGSolver::compute( const Eigen::SparseMatrix<scalar>& A )
+{
+  assert( A.rows() == A.cols() );
+  m_A = &A;
+  if( m_type == BLOCK_JACOBI ) m_block_jacobi.compute( A );
+  else if( m_type == INCOMPLETE_CHOLESKY ) m_incomplete_cholesky.compute( A );
+}
+
+bool PreconditionedCGSolver::solve( const VectorXs& b, VectorXs& x )
+{
+  assert( m_A != NULL );
+  const Eigen::SparseMatrix<scalar>& A = *m_A;
+  assert( b.size() == A.rows() );
+  if( x.size() != b.size() ) x.setZero( b.size() );
+
+  const scalar bnorm = b.norm() > 0.0 ? b.norm() : 1.0;
+
+  m_r = b - A*x;
+  m_iterations = 0;
+  m_residual = m_r.norm()/bnorm;
+  if( m_residual <= m_tolerance ) return true;
+
+  precondition( m_r, m_z );
+  m_p = m_z;
+  scalar rz = m_r.dot(m_z);
+
+  while( m_iterations < m_max_iterations )
+  {
+    m_Ap.noalias() = A*m_p;
+    scalar pAp = m_p.dot(m_Ap);
+    if( pAp <= 0.0 ) break;
+    scalar alpha = rz/pAp;
+    x += alpha*m_p;
+    m_r -= alpha*m_Ap;
+    ++m_iterations;
+
+    m_residual = m_r.norm()/bnorm;
+    if( m_residual <= m_tolerance ) return true;
+
+    precondition( m_r, m_z );
+    scalar rz_new = m_r.dot(m_z);
+    m_p = m_z + (rz_new/rz)*m_p;
+    rz = rz_new;
+  }
+
+  return m_residual <= m_tolerance;
+}
+
+int PreconditionedCGSolver::getNumIterations() const
+{
+  return m_iterations;
+}
+
+scalar PreconditionedCGSolver::getRelativeResidual() const
+{
+  return m_residual;
+}
+
+void PreconditionedCGSolver::precondition( const VectorXs& r, VectorXs& z ) const
+{
+  if( m_type == BLOCK_JACOBI ) m_block_jacobi.apply( r, z );
+  else if( m_type == INCOMPLETE_CHOLESKY ) m_incomplete_cholesky.apply( r, z );
+  else z = r;
+}
@@ -0,0 +1,54 @@
+#ifndef __PRECONDITIONED_CG_SOLVER__
+#define __PRECONDITIONED_CG_SOLVER__
+
+#include <Eigen/Sparse>
+
+#include "MathDefs.h"
+#include "BlockJacobiPreconditioner.h"
+#include "IncompleteCholeskyPreconditioner.h"
+
+// Preconditioned conjugate gradients for sparse symmetric positive definite
+// systems, such as ImplicitSystemAssembler's at moderate time steps (see there
+// for when they stop being definite). The preconditioner can be chosen per
+// scene; both preconditioners keep their setup between compute() calls as
+// long as the matrix's sparsity pattern is unchanged.
+class PreconditionedCGSolver
+{
+public:
+  enum PreconditionerType { IDENTITY, BLOCK_JACOBI, INCOMPLETE_CHOLESKY };
+
+  PreconditionedCGSolver( PreconditionerType type = BLOCK_JACOBI, scalar tolerance = 1.0e-8, int max_iterations = 1000 );
+
+  void setPreconditioner( PreconditionerType type );
+  PreconditionerType getPreconditioner() const;
+
+  void compute( const Eigen::SparseMatrix<scalar>& A );
+
+  // Solves A x = b using x as the initial guess. Returns true if the relative
+  // residual dropped below the tolerance.
+  bool solve( const VectorXs& b, VectorXs& x );
+
+  int getNumIterations() const;
+  scalar getRelativeResidual() const;
+
+private:
+  void precondition( const VectorXs& r, VectorXs& z ) const;
+
+  PreconditionerType m_type;
+  scalar m_tolerance;
+  int m_max_iterations;
+
+  const Eigen::SparseMatrix<scalar>* m_A;
+  BlockJacobiPreconditioner m_block_jacobi;
+  IncompleteCholeskyPreconditioner m_incomplete_cholesky;
+
+  int m_iterations;
+  scalar m_residual;
+
+  VectorXs m_r;
+  VectorXs m_z;
+  VectorXs m_p;
+  VectorXs m_Ap;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef __PRECONDITIONER_H__
+#define __PRECONDITIONER_H__
+
+#include <Eigen/Sparse>
+
+#include "MathDefs.h"
+
+// Approximate inverse of a sparse symmetric positive definite matrix, for use
+// with PreconditionedCGSolver.
+class Preconditioner
+{
+public:
+  virtual ~Preconditioner() {}
+
+  // Builds the preconditioner for A
+  virtual void compute( const Eigen::SparseMatrix<scalar>& A ) = 0;
+
+  // z = P^-1 r
+  virtual void apply( const VectorXs& r, VectorXs& z ) const = 0;
+};
+
+#endif
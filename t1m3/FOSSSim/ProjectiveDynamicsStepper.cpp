@@ -0,0 +1,216 @@
+#include "ProjectiveDynamicsStepper.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#include "SpringForce.h"
+
+ProjectiveDynamicsStepper::ProjectiveDynamicsStepper( int iterations, GlobalSolver global_solver )
+: SceneStepper()
+, m_iterations(iterations)
+, m_global_solver(global_solver)
+, m_num_factorizations(0)
+, m_cached_dt(-1.0)
+, m_num_free(0)
+{
+  assert( m_iterations > 0 );
+}
+
+ProjectiveDynamicsStepper::~ProjectiveDynamicsStepper()
+{}
+
+bool ProjectiveDynamicsStepper::stepScene( TwoDScene& scene, scalar dt )
+{
+  VectorXs& x = scene.getX();
+  VectorXs& v = scene.getV();
+  const VectorXs& m = scene.getM();
+  assert( x.size() == v.size() );
+  assert( x.size() == m.size() );
+
+  if( topologyChanged( scene, dt ) ) buildSystem( scene, dt );
+
+  const int nparticles = scene.getNumParticles();
+  const int nsprings = (int) m_springs.size();
+
+  // Explicit forces: everything that is not a spring, plus spring damping
+  m_gradE.setZero( x.size() );
+  for( std::vector<Force*>::size_type i = 0; i < m_explicit_forces.size(); ++i ) m_explicit_forces[i]->addGradEToTotal( x, v, m, m_gradE );
+  for( int s = 0; s < nsprings; ++s )
+  {
+    const Spring& spring = m_springs[s];
+    if( spring.b == 0.0 ) continue;
+    Vector2s n = x.segment<2>(2*spring.i) - x.segment<2>(2*spring.j);
+    scalar len = n.norm();
+    if( len == 0.0 ) continue;
+    n /= len;
+    Vector2s fdamp = -spring.b*n.dot( v.segment<2>(2*spring.i) - v.segment<2>(2*spring.j) )*n;
+    m_gradE.segment<2>(2*spring.i) -= fdamp;
+    m_gradE.segment<2>(2*spring.j) += fdamp;
+  }
+
+  // Inertial prediction, and the part of the right hand side that does not change between iterations
+  m_y.resize( m_num_free, 2 );
+  m_rhs.resize( m_num_free, 2 );
+  for( int i = 0; i < nparticles; ++i )
+  {
+    int r = m_row[i];
+    if( r < 0 ) continue;
+    m_y.row(r) = ( x.segment<2>(2*i) + dt*v.segment<2>(2*i) - dt*dt*m_gradE.segment<2>(2*i)/m(2*i) ).transpose();
+    m_rhs.row(r) = m(2*i)/(dt*dt)*m_y.row(r);
+  }
+  for( int s = 0; s < nsprings; ++s )
+  {
+    const Spring& spring = m_springs[s];
+    int ri = m_row[spring.i];
+    int rj = m_row[spring.j];
+    if( rj < 0 ) m_rhs.row(ri) += spring.k*x.segment<2>(2*spring.j).transpose();
+    if( ri < 0 ) m_rhs.row(rj) += spring.k*x.segment<2>(2*spring.i).transpose();
+  }
+
+  m_sol = m_y;
+  m_d.resize( 2, nsprings );
+  MatrixXs rhs( m_num_free, 2 );
+  for( int iter = 0; iter < m_iterations; ++iter )
+  {
+    // Local step: project each spring onto its rest length
+    #pragma omp parallel for schedule(static)
+    for( int s = 0; s < nsprings; ++s )
+    {
+      const Spring& spring = m_springs[s];
+      int ri = m_row[spring.i];
+      int rj = m_row[spring.j];
+      Vector2s pi = ri >= 0 ? Vector2s( m_sol.row(ri).transpose() ) : Vector2s( x.segment<2>(2*spring.i) );
+      Vector2s pj = rj >= 0 ? Vector2s( m_sol.row(rj).transpose() ) : Vector2s( x.segment<2>(2*spring.j) );
+      Vector2s dij = pi - pj;
+      scalar len = dij.norm();
+      // A degenerate spring exerts no force
+      m_d.col(s) = len > 0.0 ? Vector2s( spring.l0*dij/len ) : dij;
+    }
+
+    // Global step
+    rhs = m_rhs;
+    for( int s = 0; s < nsprings; ++s )
+    {
+      const Spring& spring = m_springs[s];
+      int ri = m_row[spring.i];
+      int rj = m_row[spring.j];
+      if( ri >= 0 ) rhs.row(ri) += spring.k*m_d.col(s).transpose();
+      if( rj >= 0 ) rhs.row(rj) -= spring.k*m_d.col(s).transpose();
+    }
+    if( m_global_solver == CHOLESKY )
+    {
+      m_sol = m_solver.solve( rhs );
+    }
+    else
+    {
+      for( int c = 0; c < 2; ++c )
+      {
+        m_col_rhs = rhs.col(c);
+        m_col_sol = m_sol.col(c);
+        m_jacobi.solve( m_col_rhs, m_col_sol );
+        m_sol.col(c) = m_col_sol;
+      }
+    }
+  }
+
+  for( int i = 0; i < nparticles; ++i )
+  {
+    int r = m_row[i];
+    if( r < 0 ) continue;
+    v.segment<2>(2*i) = ( m_sol.row(r).transpose() - x.segment<2>(2*i) )/dt;
+    x.segment<2>(2*i) = m_sol.row(r).transpose();
+  }
+
+  return true;
+}
+
+std::string ProjectiveDynamicsStepper::getName() const
+{
+  return "Projective Dynamics";
+}
+
+int ProjectiveDynamicsStepper::getNumFactorizations() const
+{
+  return m_num_factorizations;
+}
+
+bool ProjectiveDynamicsStepper::topologyChanged( const TwoDScene& scene, scalar dt ) const
+{
+  if( dt != m_cached_dt ) return true;
+  if( scene.getForces() != m_cached_forces ) return true;
+  if( scene.getM().size() != m_cached_m.size() || scene.getM() != m_cached_m ) return true;
+  for( int i = 0; i < scene.getNumParticles(); ++i ) if( scene.isFixed(i) != m_cached_fixed[i] ) return true;
+  return false;
+}
+
+void ProjectiveDynamicsStepper::buildSystem( const TwoDScene& scene, scalar dt )
+{
+  const int nparticles = scene.getNumParticles();
+  const VectorXs& m = scene.getM();
+
+  m_cached_dt = dt;
+  m_cached_forces = scene.getForces();
+  m_cached_m = m;
+  m_cached_fixed.resize( nparticles );
+  for( int i = 0; i < nparticles; ++i ) m_cached_fixed[i] = scene.isFixed(i);
+
+  m_row.assign( nparticles, -1 );
+  m_num_free = 0;
+  for( int i = 0; i < nparticles; ++i ) if( !scene.isFixed(i) ) m_row[i] = m_num_free++;
+
+  m_explicit_forces.clear();
+  m_springs.clear();
+  for( std::vector<Force*>::size_type f = 0; f < m_cached_forces.size(); ++f )
+  {
+    const SpringForce* springforce = dynamic_cast<const SpringForce*>( m_cached_forces[f] );
+    if( springforce == NULL )
+    {
+      m_explicit_forces.push_back( m_cached_forces[f] );
+      continue;
+    }
+    Spring spring;
+    spring.i = springforce->getEndpoints().first;
+    spring.j = springforce->getEndpoints().second;
+    spring.k = springforce->getK();
+    spring.l0 = springforce->getL0();
+    spring.b = springforce->getB();
+    // Springs between two fixed particles do nothing
+    if( m_row[spring.i] < 0 && m_row[spring.j] < 0 ) continue;
+    m_springs.push_back( spring );
+  }
+
+  std::vector< Eigen::Triplet<scalar> > triplets;
+  triplets.reserve( m_num_free + 4*m_springs.size() );
+  for( int i = 0; i < nparticles; ++i ) if( m_row[i] >= 0 ) triplets.push_back( Eigen::Triplet<scalar>( m_row[i], m_row[i], m(2*i)/(dt*dt) ) );
+  for( std::vector<Spring>::size_type s = 0; s < m_springs.size(); ++s )
+  {
+    int ri = m_row[m_springs[s].i];
+    int rj = m_row[m_springs[s].j];
+    scalar k = m_springs[s].k;
+    if( ri >= 0 ) triplets.push_back( Eigen::Triplet<scalar>( ri, ri, k ) );
+    if( rj >= 0 ) triplets.push_back( Eigen::Triplet<scalar>( rj, rj, k ) );
+    if( ri >= 0 && rj >= 0 )
+    {
+      triplets.push_back( Eigen::Triplet<scalar>( ri, rj, -k ) );
+      triplets.push_back( Eigen::Triplet<scalar>( rj, ri, -k ) );
+    }
+  }
+
+  Eigen::SparseMatrix<scalar> A( m_num_free, m_num_free );
+  A.setFromTriplets( triplets.begin(), triplets.end() );
+
+  if( m_global_solver == CHEBYSHEV_JACOBI )
+  {
+    m_jacobi.compute( A );
+    ++m_num_factorizations;
+    return;
+  }
+
+  m_solver.compute( A );
+  if( m_solver.info() != Eigen::Success )
+  {
+    std::cerr << "\033[31;1mERROR IN PROJECTIVEDYNAMICSSTEPPER:\033[m Failed to factor the global system matrix. Exiting." << std::endl;
+    exit(1);
+  }
+  ++m_num_factorizations;
+}
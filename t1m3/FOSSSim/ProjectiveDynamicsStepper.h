@@ -0,0 +1,90 @@
+#ifndef __PROJECTIVE_DYNAMICS_STEPPER__
+#define __PROJECTIVE_DYNAMICS_STEPPER__
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <iostream>
+#include <vector>
+
+#include "SceneStepper.h"
+#include "ChebyshevJacobiSolver.h"
+
+// Projective dynamics for mass-spring networks (Liu et al. 2013, Bouaziz et
+// al. 2014). Each step minimizes
+//
+//   1/(2h^2) |x - y|_M^2 + sum_s k_s/2 |x_i - x_j - d_s|^2
+//
+// by alternating a local step, which projects every spring onto its rest
+// length (d_s = l0*(x_i-x_j)/|x_i-x_j|) in parallel, with a global step that
+// solves the resulting linear system. The system matrix M/h^2 + sum_s k_s L_s
+// depends only on masses, stiffnesses, fixed particles and dt. It is factored
+// once with a sparse Cholesky and reused for every iteration and step until
+// one of those changes, so each iteration costs a pair of triangular solves.
+//
+// Alternatively the global step can be solved with the data parallel
+// Chebyshev accelerated Jacobi solver, warm started from the previous
+// iterate, which trades the factorization for cheap parallel sweeps.
+//
+// Forces other than springs, and spring damping, are applied explicitly in
+// the inertial prediction y = x + h*v + h^2*M^-1*f.
+class ProjectiveDynamicsStepper : public SceneStepper
+{
+public:
+  enum GlobalSolver { CHOLESKY, CHEBYSHEV_JACOBI };
+
+  ProjectiveDynamicsStepper( int iterations = 10, GlobalSolver global_solver = CHOLESKY );
+  
+  virtual ~ProjectiveDynamicsStepper();
+  
+  virtual bool stepScene( TwoDScene& scene, scalar dt );
+  
+  virtual std::string getName() const;
+
+  // Number of times the global matrix has been factored (or, with the
+  // Jacobi solver, handed to the solver)
+  int getNumFactorizations() const;
+
+private:
+  struct Spring
+  {
+    int i;
+    int j;
+    scalar k;
+    scalar l0;
+    scalar b;
+  };
+
+  bool topologyChanged( const TwoDScene& scene, scalar dt ) const;
+
+  void buildSystem( const TwoDScene& scene, scalar dt );
+
+  int m_iterations;
+  GlobalSolver m_global_solver;
+  int m_num_factorizations;
+
+  // Topology cache
+  std::vector<Force*> m_cached_forces;
+  std::vector<bool> m_cached_fixed;
+  VectorXs m_cached_m;
+  scalar m_cached_dt;
+
+  std::vector<Force*> m_explicit_forces;
+  std::vector<Spring> m_springs;
+  // Row of each particle in the global system, -1 for fixed particles
+  std::vector<int> m_row;
+  int m_num_free;
+
+  Eigen::SimplicialLLT< Eigen::SparseMatrix<scalar> > m_solver;
+  ChebyshevJacobiSolver m_jacobi;
+  VectorXs m_col_rhs;
+  VectorXs m_col_sol;
+  // Projected spring directions (2 x num springs)
+  MatrixXs m_d;
+  // Inertial prediction, global right hand side and solution (num free x 2)
+  MatrixXs m_y;
+  MatrixXs m_rhs;
+  MatrixXs m_sol;
+  VectorXs m_gradE;
+};
+
+#endif
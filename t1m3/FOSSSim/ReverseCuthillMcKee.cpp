@@ -0,0 +1,103 @@
+#include "ReverseCuthillMcKee.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+  struct DegreeLess
+  {
+    DegreeLess( const std::vector< std::vector<int> >& adjacency ) : m_adjacency(adjacency) {}
+    bool operator()( int a, int b ) const
+    {
+      if( m_adjacency[a].size() != m_adjacency[b].size() ) return m_adjacency[a].size() < m_adjacency[b].size();
+      return a < b;
+    }
+    const std::vector< std::vector<int> >& m_adjacency;
+  };
+
+  // Breadth first search from root over unvisited vertices. Returns the number
+  // of levels; last_level receives the vertices of the deepest one.
+  int levelStructure( const std::vector< std::vector<int> >& adjacency, int root, const std::vector<bool>& visited, std::vector<int>& level, std::vector<int>& last_level )
+  {
+    std::vector<int> frontier( 1, root );
+    std::vector<int> next;
+    level[root] = 0;
+    std::vector<int> touched( 1, root );
+    int depth = 0;
+    while( true )
+    {
+      next.clear();
+      for( std::vector<int>::size_type f = 0; f < frontier.size(); ++f )
+      {
+        const std::vector<int>& neighbors = adjacency[frontier[f]];
+        for( std::vector<int>::size_type n = 0; n < neighbors.size(); ++n )
+        {
+          int v = neighbors[n];
+          if( visited[v] || level[v] >= 0 ) continue;
+          level[v] = depth + 1;
+          next.push_back(v);
+          touched.push_back(v);
+        }
+      }
+      if( next.empty() ) break;
+      frontier.swap(next);
+      ++depth;
+    }
+    last_level = frontier;
+    for( std::vector<int>::size_type t = 0; t < touched.size(); ++t ) level[touched[t]] = -1;
+    return depth;
+  }
+}
+
+void reverseCuthillMcKee( const std::vector< std::vector<int> >& adjacency, std::vector<int>& order )
+{
+  const int n = (int) adjacency.size();
+  order.clear();
+  order.reserve(n);
+
+  std::vector<bool> visited( n, false );
+  std::vector<int> level( n, -1 );
+  std::vector<int> last_level;
+  DegreeLess degree_less( adjacency );
+
+  for( int seed = 0; seed < n; ++seed )
+  {
+    if( visited[seed] ) continue;
+
+    // Pseudo-peripheral root (George-Liu): move to a minimum degree vertex of
+    // the deepest level until the eccentricity stops growing
+    int root = seed;
+    int depth = levelStructure( adjacency, root, visited, level, last_level );
+    while( true )
+    {
+      int candidate = *std::min_element( last_level.begin(), last_level.end(), degree_less );
+      int candidate_depth = levelStructure( adjacency, candidate, visited, level, last_level );
+      if( candidate_depth <= depth ) break;
+      root = candidate;
+      depth = candidate_depth;
+    }
+
+    // Cuthill-McKee: breadth first, neighbors in increasing degree order
+    std::vector<int>::size_type head = order.size();
+    order.push_back(root);
+    visited[root] = true;
+    std::vector<int> neighbors;
+    while( head < order.size() )
+    {
+      int u = order[head++];
+      neighbors.clear();
+      for( std::vector<int>::size_type k = 0; k < adjacency[u].size(); ++k ) if( !visited[adjacency[u][k]] ) neighbors.push_back( adjacency[u][k] );
+      std::sort( neighbors.begin(), neighbors.end(), degree_less );
+      for( std::vector<int>::size_type k = 0; k < neighbors.size(); ++k )
+      {
+        if( visited[neighbors[k]] ) continue;
+        visited[neighbors[k]] = true;
+        order.push_back( neighbors[k] );
+      }
+    }
+  }
+
+  assert( (int) order.size() == n );
+  std::reverse( order.begin(), order.end() );
+}
@@ -0,0 +1,13 @@
+#ifndef __REVERSE_CUTHILL_MCKEE_H__
+#define __REVERSE_CUTHILL_MCKEE_H__
+
+#include <vector>
+
+// Computes a reverse Cuthill-McKee ordering of an undirected graph given as
+// adjacency lists. On return order[k] is the vertex placed at position k.
+// Each connected component is started from a pseudo-peripheral vertex, found
+// by repeated breadth first searches, which for chains and strips yields the
+// natural end-to-end ordering regardless of how the vertices were numbered.
+void reverseCuthillMcKee( const std::vector< std::vector<int> >& adjacency, std::vector<int>& order );
+
+#endif
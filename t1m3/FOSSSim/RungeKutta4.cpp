@@ -0,0 +1,87 @@
+#include "RungeKutta4.h"
+
+namespace
+{
+  enum { GRADE_SLOT, ACCELERATION_SLOT, STAGE_X_SLOT, STAGE_V_SLOT, SUM_X_SLOT, SUM_V_SLOT };
+}
+
+RungeKutta4::RungeKutta4()
+: SceneStepper()
+, m_workspace()
+{}
+
+RungeKutta4::~RungeKutta4()
+{}
+
+bool RungeKutta4::stepScene( TwoDScene& scene, scalar dt )
+{
+  return stepSceneN( scene, dt, 1 );
+}
+
+bool RungeKutta4::stepSceneN( TwoDScene& scene, scalar dt, int n )
+{
+  VectorXs& x = scene.getX();
+  VectorXs& v = scene.getV();
+  assert( x.size() == v.size() );
+  assert( x.size() == scene.getM().size() );
+
+  m_workspace.prepare( scene );
+  const VectorXs& free = m_workspace.getFreeMask();
+  VectorXs& a = m_workspace.getVector( ACCELERATION_SLOT );
+  VectorXs& xs = m_workspace.getVector( STAGE_X_SLOT );
+  VectorXs& vs = m_workspace.getVector( STAGE_V_SLOT );
+  VectorXs& sumx = m_workspace.getVector( SUM_X_SLOT );
+  VectorXs& sumv = m_workspace.getVector( SUM_V_SLOT );
+
+  for( int i = 0; i < n; ++i )
+  {
+    // Stage 1, evaluated at the start of step state
+    computeAcceleration( scene, x, v, a );
+    sumx = v;
+    sumv = a;
+    xs = x + (0.5*dt)*v.cwiseProduct(free);
+    vs = v + (0.5*dt)*a;
+
+    // Stage 2. The stage position update reads the old stage velocity, so it has to come first.
+    computeAcceleration( scene, xs, vs, a );
+    sumx += 2.0*vs;
+    sumv += 2.0*a;
+    xs = x + (0.5*dt)*vs.cwiseProduct(free);
+    vs = v + (0.5*dt)*a;
+
+    // Stage 3
+    computeAcceleration( scene, xs, vs, a );
+    sumx += 2.0*vs;
+    sumv += 2.0*a;
+    xs = x + dt*vs.cwiseProduct(free);
+    vs = v + dt*a;
+
+    // Stage 4
+    computeAcceleration( scene, xs, vs, a );
+    sumx += vs;
+    sumv += a;
+
+    x += (dt/6.0)*sumx.cwiseProduct(free);
+    v += (dt/6.0)*sumv;
+  }
+
+  return true;
+}
+
+std::string RungeKutta4::getName() const
+{
+  return "Runge-Kutta 4";
+}
+
+void RungeKutta4::computeAcceleration( const TwoDScene& scene, const VectorXs& x, const VectorXs& v, VectorXs& a )
+{
+  const VectorXs& m = scene.getM();
+  const std::vector<Force*>& forces = scene.getForces();
+
+  VectorXs& gradE = m_workspace.getVector( GRADE_SLOT );
+
+  gradE.setZero();
+  for( std::vector<Force*>::size_type i = 0; i < forces.size(); ++i ) forces[i]->addGradEToTotal( x, v, m, gradE );
+
+  a = -gradE.cwiseQuotient(m).cwiseProduct( m_workspace.getFreeMask() );
+}
@@ -0,0 +1,37 @@
+#ifndef __RUNGE_KUTTA_4__
+#define __RUNGE_KUTTA_4__
+
+#include <Eigen/Dense>
+#include <iostream>
+
+#include "SceneStepper.h"
+#include "StepperWorkspace.h"
+
+// Classic fourth order Runge-Kutta on the first order system (x' = v, v' = a).
+// Four force evaluations per step. The stage state and the running weighted
+// sums of the stage derivatives live in a StepperWorkspace, so a step
+// allocates nothing once the buffers have been sized.
+class RungeKutta4 : public SceneStepper
+{
+public:
+  RungeKutta4();
+  
+  virtual ~RungeKutta4();
+  
+  virtual bool stepScene( TwoDScene& scene, scalar dt );
+
+  // Advances the scene n steps of size dt. The workspace is prepared and the
+  // fixed flags read once for all n steps, so nothing may change the scene
+  // in between; use stepScene when something does, e.g. collision handling.
+  bool stepSceneN( TwoDScene& scene, scalar dt, int n );
+  
+  virtual std::string getName() const;
+
+private:
+  // a = -gradE(x,v)/m, zero on fixed degrees of freedom
+  void computeAcceleration( const TwoDScene& scene, const VectorXs& x, const VectorXs& v, VectorXs& a );
+
+  StepperWorkspace m_workspace;
+};
+
+#endif
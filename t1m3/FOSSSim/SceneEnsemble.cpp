@@ -0,0 +1,266 @@
+#include "SceneEnsemble.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#include "SpringForce.h"
+#include "DragDampingForce.h"
+#include "GravitationalForce.h"
+#include "SimpleGravityForce.h"
+
+SceneEnsemble::SceneEnsemble( const TwoDScene& scene, scalar dt, int num_instances )
+: m_num_instances(num_instances)
+, m_num_particles(scene.getNumParticles())
+, m_gravity(Vector2s::Zero())
+{
+  assert( m_num_instances > 0 );
+  const int K = m_num_instances;
+  const int ndof = 2*m_num_particles;
+  const VectorXs& x = scene.getX();
+  const VectorXs& v = scene.getV();
+  const VectorXs& m = scene.getM();
+
+  m_mass.resize( m_num_particles );
+  m_inverse_mass.resize( m_num_particles );
+  m_fixed.resize( m_num_particles );
+  for( int i = 0; i < m_num_particles; ++i )
+  {
+    m_mass[i] = m(2*i);
+    m_inverse_mass[i] = scene.isFixed(i) ? 0.0 : 1.0/m(2*i);
+    m_fixed[i] = scene.isFixed(i);
+  }
+
+  m_x.resize( ndof*K );
+  m_v.resize( ndof*K );
+  m_F.resize( ndof*K );
+  for( int d = 0; d < ndof; ++d )
+  {
+    for( int k = 0; k < K; ++k )
+    {
+      m_x[d*K + k] = x(d);
+      m_v[d*K + k] = v(d);
+    }
+  }
+  m_dt.assign( K, dt );
+
+  scalar drag = 0.0;
+  const std::vector<Force*>& forces = scene.getForces();
+  for( std::vector<Force*>::size_type f = 0; f < forces.size(); ++f )
+  {
+    if( const SpringForce* spring = dynamic_cast<const SpringForce*>( forces[f] ) )
+    {
+      m_spring_endpoints.push_back( spring->getEndpoints() );
+      m_spring_l0.push_back( spring->getL0() );
+      m_spring_k.insert( m_spring_k.end(), K, spring->getK() );
+      m_spring_b.insert( m_spring_b.end(), K, spring->getB() );
+    }
+    else if( const GravitationalForce* gravity = dynamic_cast<const GravitationalForce*>( forces[f] ) )
+    {
+      m_gravitational_pairs.push_back( gravity->getParticles() );
+      m_gravitational_G.push_back( gravity->getG() );
+    }
+    else if( const SimpleGravityForce* gravity = dynamic_cast<const SimpleGravityForce*>( forces[f] ) )
+    {
+      m_gravity += gravity->getGravity();
+    }
+    else if( const DragDampingForce* damping = dynamic_cast<const DragDampingForce*>( forces[f] ) )
+    {
+      drag += damping->getB();
+    }
+    else
+    {
+      std::cerr << "\033[31;1mERROR IN SCENEENSEMBLE:\033[m Unsupported force type in ensemble scene. Exiting." << std::endl;
+      exit(1);
+    }
+  }
+  m_drag.assign( K, drag );
+}
+
+int SceneEnsemble::getNumInstances() const
+{
+  return m_num_instances;
+}
+
+int SceneEnsemble::getNumParticles() const
+{
+  return m_num_particles;
+}
+
+int SceneEnsemble::getNumSprings() const
+{
+  return (int) m_spring_endpoints.size();
+}
+
+void SceneEnsemble::setTimestep( int instance, scalar dt )
+{
+  assert( instance >= 0 && instance < m_num_instances );
+  m_dt[instance] = dt;
+}
+
+void SceneEnsemble::setPosition( int instance, int particle, const Vector2s& pos )
+{
+  assert( instance >= 0 && instance < m_num_instances );
+  assert( particle >= 0 && particle < m_num_particles );
+  m_x[(2*particle)*m_num_instances + instance] = pos.x();
+  m_x[(2*particle+1)*m_num_instances + instance] = pos.y();
+}
+
+void SceneEnsemble::setVelocity( int instance, int particle, const Vector2s& vel )
+{
+  assert( instance >= 0 && instance < m_num_instances );
+  assert( particle >= 0 && particle < m_num_particles );
+  m_v[(2*particle)*m_num_instances + instance] = vel.x();
+  m_v[(2*particle+1)*m_num_instances + instance] = vel.y();
+}
+
+void SceneEnsemble::setSpring( int instance, int spring, scalar k, scalar b )
+{
+  assert( instance >= 0 && instance < m_num_instances );
+  assert( spring >= 0 && spring < getNumSprings() );
+  m_spring_k[spring*m_num_instances + instance] = k;
+  m_spring_b[spring*m_num_instances + instance] = b;
+}
+
+void SceneEnsemble::setDragDamping( int instance, scalar b )
+{
+  assert( instance >= 0 && instance < m_num_instances );
+  m_drag[instance] = b;
+}
+
+void SceneEnsemble::step( int n )
+{
+  const int K = m_num_instances;
+  const scalar* dt = &m_dt[0];
+
+  for( int s = 0; s < n; ++s )
+  {
+    accumulateForces();
+
+    // Symplectic Euler: v += dt*F/m, then x += dt*v
+    for( int i = 0; i < m_num_particles; ++i )
+    {
+      if( m_fixed[i] ) continue;
+      const scalar w = m_inverse_mass[i];
+      for( int c = 0; c < 2; ++c )
+      {
+        scalar* x = &m_x[(2*i+c)*K];
+        scalar* v = &m_v[(2*i+c)*K];
+        const scalar* F = &m_F[(2*i+c)*K];
+        #pragma omp simd
+        for( int k = 0; k < K; ++k )
+        {
+          v[k] += dt[k]*w*F[k];
+          x[k] += dt[k]*v[k];
+        }
+      }
+    }
+  }
+}
+
+void SceneEnsemble::copyInstanceToScene( int instance, TwoDScene& scene ) const
+{
+  assert( instance >= 0 && instance < m_num_instances );
+  assert( scene.getNumParticles() == m_num_particles );
+  VectorXs& x = scene.getX();
+  VectorXs& v = scene.getV();
+  for( int d = 0; d < 2*m_num_particles; ++d )
+  {
+    x(d) = m_x[d*m_num_instances + instance];
+    v(d) = m_v[d*m_num_instances + instance];
+  }
+}
+
+void SceneEnsemble::writeInstancePositions( std::ostream& os, int instance ) const
+{
+  assert( instance >= 0 && instance < m_num_instances );
+  for( int d = 0; d < 2*m_num_particles; ++d )
+  {
+    scalar value = m_x[d*m_num_instances + instance];
+    os.write( reinterpret_cast<const char*>( &value ), sizeof(scalar) );
+  }
+}
+
+void SceneEnsemble::accumulateForces()
+{
+  const int K = m_num_instances;
+  const scalar* drag = &m_drag[0];
+
+  // Gravity and drag
+  for( int i = 0; i < m_num_particles; ++i )
+  {
+    for( int c = 0; c < 2; ++c )
+    {
+      scalar* F = &m_F[(2*i+c)*K];
+      const scalar* v = &m_v[(2*i+c)*K];
+      const scalar g = m_mass[i]*m_gravity(c);
+      #pragma omp simd
+      for( int k = 0; k < K; ++k ) F[k] = g - drag[k]*v[k];
+    }
+  }
+
+  // Springs: f = -k(l - l0) - b (vi - vj).n along n = (xi - xj)/l
+  for( std::vector< std::pair<int,int> >::size_type s = 0; s < m_spring_endpoints.size(); ++s )
+  {
+    const int i = m_spring_endpoints[s].first;
+    const int j = m_spring_endpoints[s].second;
+    const scalar l0 = m_spring_l0[s];
+    const scalar* ks = &m_spring_k[s*K];
+    const scalar* bs = &m_spring_b[s*K];
+    const scalar* xi = &m_x[2*i*K];
+    const scalar* yi = &m_x[(2*i+1)*K];
+    const scalar* xj = &m_x[2*j*K];
+    const scalar* yj = &m_x[(2*j+1)*K];
+    const scalar* vxi = &m_v[2*i*K];
+    const scalar* vyi = &m_v[(2*i+1)*K];
+    const scalar* vxj = &m_v[2*j*K];
+    const scalar* vyj = &m_v[(2*j+1)*K];
+    scalar* Fxi = &m_F[2*i*K];
+    scalar* Fyi = &m_F[(2*i+1)*K];
+    scalar* Fxj = &m_F[2*j*K];
+    scalar* Fyj = &m_F[(2*j+1)*K];
+    #pragma omp simd
+    for( int k = 0; k < K; ++k )
+    {
+      scalar dx = xi[k] - xj[k];
+      scalar dy = yi[k] - yj[k];
+      scalar l = std::sqrt( dx*dx + dy*dy );
+      scalar inv = l > 0.0 ? 1.0/l : 0.0;
+      scalar nx = dx*inv;
+      scalar ny = dy*inv;
+      scalar f = -ks[k]*( l - l0 ) - bs[k]*( ( vxi[k] - vxj[k] )*nx + ( vyi[k] - vyj[k] )*ny );
+      Fxi[k] += f*nx;
+      Fyi[k] += f*ny;
+      Fxj[k] -= f*nx;
+      Fyj[k] -= f*ny;
+    }
+  }
+
+  // Gravitational attraction: f = G mi mj / r^2 towards the other particle
+  for( std::vector< std::pair<int,int> >::size_type g = 0; g < m_gravitational_pairs.size(); ++g )
+  {
+    const int i = m_gravitational_pairs[g].first;
+    const int j = m_gravitational_pairs[g].second;
+    const scalar Gmm = m_gravitational_G[g]*m_mass[i]*m_mass[j];
+    const scalar* xi = &m_x[2*i*K];
+    const scalar* yi = &m_x[(2*i+1)*K];
+    const scalar* xj = &m_x[2*j*K];
+    const scalar* yj = &m_x[(2*j+1)*K];
+    scalar* Fxi = &m_F[2*i*K];
+    scalar* Fyi = &m_F[(2*i+1)*K];
+    scalar* Fxj = &m_F[2*j*K];
+    scalar* Fyj = &m_F[(2*j+1)*K];
+    #pragma omp simd
+    for( int k = 0; k < K; ++k )
+    {
+      scalar dx = xj[k] - xi[k];
+      scalar dy = yj[k] - yi[k];
+      scalar r2 = dx*dx + dy*dy;
+      scalar r = std::sqrt(r2);
+      scalar s = r > 0.0 ? Gmm/(r2*r) : 0.0;
+      Fxi[k] += s*dx;
+      Fyi[k] += s*dy;
+      Fxj[k] -= s*dx;
+      Fyj[k] -= s*dy;
+    }
+  }
+}
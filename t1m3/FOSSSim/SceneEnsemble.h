@@ -0,0 +1,78 @@
+#ifndef __SCENE_ENSEMBLE_H__
+#define __SCENE_ENSEMBLE_H__
+
+#include <iostream>
+#include <vector>
+
+#include "TwoDScene.h"
+#include "MathDefs.h"
+
+// Steps many copies of one scene topology in lockstep, for parameter sweeps.
+// The per instance state is stored interleaved with the instance index
+// innermost, i.e. x[(2*particle + coordinate)*K + instance], so that every
+// force and update kernel is a contiguous loop over instances that the
+// compiler vectorizes.
+//
+// All instances share particles, masses, fixed flags, edges and force
+// topology. Initial positions and velocities, spring stiffness and damping,
+// drag and the time step can differ per instance. Instances are advanced with
+// symplectic Euler. Supported forces are SpringForce, SimpleGravityForce,
+// DragDampingForce and GravitationalForce.
+class SceneEnsemble
+{
+public:
+  // Creates num_instances copies of scene's current state and parameters
+  SceneEnsemble( const TwoDScene& scene, scalar dt, int num_instances );
+
+  int getNumInstances() const;
+  int getNumParticles() const;
+  int getNumSprings() const;
+
+  void setTimestep( int instance, scalar dt );
+  void setPosition( int instance, int particle, const Vector2s& pos );
+  void setVelocity( int instance, int particle, const Vector2s& vel );
+  // Springs are numbered in the order they were inserted into the scene
+  void setSpring( int instance, int spring, scalar k, scalar b );
+  void setDragDamping( int instance, scalar b );
+
+  // Advances every instance by its own time step, n times
+  void step( int n = 1 );
+
+  // Copies one instance's state into a scene with the same topology, e.g. for rendering or output
+  void copyInstanceToScene( int instance, TwoDScene& scene ) const;
+
+  // Writes one instance's positions as raw doubles, x0 y0 x1 y1 ...
+  void writeInstancePositions( std::ostream& os, int instance ) const;
+
+private:
+  void accumulateForces();
+
+  int m_num_instances;
+  int m_num_particles;
+
+  // Shared per particle data
+  std::vector<scalar> m_inverse_mass;
+  std::vector<scalar> m_mass;
+  std::vector<bool> m_fixed;
+
+  // Interleaved per instance state and force accumulator
+  std::vector<scalar> m_x;
+  std::vector<scalar> m_v;
+  std::vector<scalar> m_F;
+  std::vector<scalar> m_dt;
+
+  // Springs: shared endpoints and rest lengths, interleaved per instance k and b
+  std::vector< std::pair<int,int> > m_spring_endpoints;
+  std::vector<scalar> m_spring_l0;
+  std::vector<scalar> m_spring_k;
+  std::vector<scalar> m_spring_b;
+
+  // Gravitational pairs with their constants
+  std::vector< std::pair<int,int> > m_gravitational_pairs;
+  std::vector<scalar> m_gravitational_G;
+
+  Vector2s m_gravity;
+  std::vector<scalar> m_drag;
+};
+
+#endif
@@ -23,6 +23,8 @@ public:
   
   virtual Force* createNewCopy();
 
+  const Vector2s& getGravity() const { return m_gravity; }
+
 private:
   Vector2s m_gravity;
 };
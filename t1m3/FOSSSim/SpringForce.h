@@ -23,6 +23,11 @@ public:
   
   virtual Force* createNewCopy();
 
+  const std::pair<int,int>& getEndpoints() const { return m_endpoints; }
+  const scalar& getK() const { return m_k; }
+  const scalar& getL0() const { return m_l0; }
+  const scalar& getB() const { return m_b; }
+
 private:
   std::pair<int,int> m_endpoints;
   scalar m_k;
@@ -0,0 +1,44 @@
+#include "StepperWorkspace.h"
+
+StepperWorkspace::StepperWorkspace()
+: m_scene(NULL)
+, m_ndof(-1)
+{}
+
+bool StepperWorkspace::prepare( const TwoDScene& scene )
+{
+  // Particles can be fixed or freed between any two calls, and checking the
+  // flags costs as much as copying them, so the mask is always rebuilt
+  m_free.resize( scene.getX().size() );
+  for( int i = 0; i < scene.getNumParticles(); ++i ) m_free.segment<2>(2*i).setConstant( scene.isFixed(i) ? 0.0 : 1.0 );
+
+  if( m_scene == &scene && m_ndof == m_free.size() ) return false;
+
+  m_scene = &scene;
+  m_ndof = m_free.size();
+
+  // Keep the slots but drop their storage; they are resized lazily on next use
+  for( std::deque<VectorXs>::size_type i = 0; i < m_vectors.size(); ++i ) m_vectors[i].resize(0);
+
+  return true;
+}
+
+int StepperWorkspace::getNumDofs() const
+{
+  return m_ndof;
+}
+
+const VectorXs& StepperWorkspace::getFreeMask() const
+{
+  assert( m_ndof >= 0 );
+  return m_free;
+}
+
+VectorXs& StepperWorkspace::getVector( int slot )
+{
+  assert( m_ndof >= 0 );
+  assert( slot >= 0 );
+  if( slot >= (int) m_vectors.size() ) m_vectors.resize( slot + 1 );
+  if( m_vectors[slot].size() != m_ndof ) m_vectors[slot].setZero( m_ndof );
+  return m_vectors[slot];
+}
@@ -0,0 +1,41 @@
+#ifndef __STEPPER_WORKSPACE_H__
+#define __STEPPER_WORKSPACE_H__
+
+#include <deque>
+
+#include "TwoDScene.h"
+#include "MathDefs.h"
+
+// Scratch storage that a SceneStepper keeps between calls to stepScene.
+// Buffers are sized for the scene on first use and then reused; they are only
+// reallocated when a different scene is stepped or the number of degrees of
+// freedom changes. The free mask is refreshed from the scene's fixed flags on
+// every prepare(), so fixing or freeing particles between calls needs no
+// further bookkeeping.
+class StepperWorkspace
+{
+public:
+  StepperWorkspace();
+
+  // Call at the start of every stepScene or stepSceneN call. Returns true if
+  // the buffers were (re)initialized for this scene.
+  bool prepare( const TwoDScene& scene );
+
+  int getNumDofs() const;
+
+  // 1 for free degrees of freedom, 0 for fixed ones
+  const VectorXs& getFreeMask() const;
+
+  // ndof sized vector in the given slot. Contents persist between steps, and
+  // references stay valid when further slots are requested.
+  VectorXs& getVector( int slot );
+
+private:
+  const TwoDScene* m_scene;
+  int m_ndof;
+
+  VectorXs m_free;
+  std::deque<VectorXs> m_vectors;
+};
+
+#endif
@@ -62,6 +62,8 @@ public:
   
   void insertForce( Force* newforce );
 
+  const std::vector<Force*>& getForces() const { return m_forces; }
+
   void accumulateGradU( VectorXs& F, const VectorXs& dx = VectorXs(), const VectorXs& dv = VectorXs() );
 
   void accumulateddUdxdx( MatrixXs& A, const VectorXs& dx = VectorXs(), const VectorXs& dv = VectorXs() );
@@ -0,0 +1,73 @@
+#include "VelocityVerlet.h"
+
+namespace
+{
+  enum { GRADE_SLOT, ACCELERATION_SLOT, CACHED_X_SLOT, CACHED_V_SLOT, CACHED_FREE_SLOT };
+}
+
+VelocityVerlet::VelocityVerlet()
+: SceneStepper()
+, m_workspace()
+{}
+
+VelocityVerlet::~VelocityVerlet()
+{}
+
+bool VelocityVerlet::stepScene( TwoDScene& scene, scalar dt )
+{
+  return stepSceneN( scene, dt, 1 );
+}
+
+bool VelocityVerlet::stepSceneN( TwoDScene& scene, scalar dt, int n )
+{
+  VectorXs& x = scene.getX();
+  VectorXs& v = scene.getV();
+  assert( x.size() == v.size() );
+  assert( x.size() == scene.getM().size() );
+
+  const bool reset = m_workspace.prepare( scene );
+  const VectorXs& free = m_workspace.getFreeMask();
+  VectorXs& a = m_workspace.getVector( ACCELERATION_SLOT );
+  VectorXs& cached_x = m_workspace.getVector( CACHED_X_SLOT );
+  VectorXs& cached_v = m_workspace.getVector( CACHED_V_SLOT );
+  VectorXs& cached_free = m_workspace.getVector( CACHED_FREE_SLOT );
+
+  // The closing half kick's acceleration opens the next step, as long as
+  // nothing touched the state or the fixed set in between. That leaves one
+  // force evaluation per step. Velocity dependent forces then see the half
+  // kicked velocity the acceleration was computed with, not the final one;
+  // this is the usual trade-off for damped velocity Verlet.
+  if( reset || x != cached_x || v != cached_v || free != cached_free ) computeAcceleration( scene, x, v, a );
+
+  // Half kick, drift, half kick. Each update is a single pass over the state.
+  for( int i = 0; i < n; ++i )
+  {
+    v += (0.5*dt)*a;
+    x += dt*v.cwiseProduct(free);
+    computeAcceleration( scene, x, v, a );
+    v += (0.5*dt)*a;
+  }
+
+  cached_x = x;
+  cached_v = v;
+  cached_free = free;
+
+  return true;
+}
+
+std::string VelocityVerlet::getName() const
+{
+  return "Velocity Verlet";
+}
+
+void VelocityVerlet::computeAcceleration( const TwoDScene& scene, const VectorXs& x, const VectorXs& v, VectorXs& a )
+{
+  const VectorXs& m = scene.getM();
+  const std::vector<Force*>& forces = scene.getForces();
+  VectorXs& gradE = m_workspace.getVector( GRADE_SLOT );
+
+  gradE.setZero();
+  for( std::vector<Force*>::size_type i = 0; i < forces.size(); ++i ) forces[i]->addGradEToTotal( x, v, m, gradE );
+
+  a = -gradE.cwiseQuotient(m).cwiseProduct( m_workspace.getFreeMask() );
+}
@@ -0,0 +1,38 @@
+#ifndef __VELOCITY_VERLET__
+#define __VELOCITY_VERLET__
+
+#include <Eigen/Dense>
+#include <iostream>
+
+#include "SceneStepper.h"
+#include "StepperWorkspace.h"
+
+// Kick-drift-kick velocity Verlet. Second order and symplectic for position
+// dependent forces, at one force evaluation per step once running: the end of
+// step acceleration is kept and reused by the next step's first half kick.
+// Work vectors live in a StepperWorkspace so that no allocation happens after
+// the first step.
+class VelocityVerlet : public SceneStepper
+{
+public:
+  VelocityVerlet();
+  
+  virtual ~VelocityVerlet();
+  
+  virtual bool stepScene( TwoDScene& scene, scalar dt );
+
+  // Advances the scene n steps of size dt. The workspace is prepared and the
+  // fixed flags read once for all n steps, so nothing may change the scene
+  // in between; use stepScene when something does, e.g. collision handling.
+  bool stepSceneN( TwoDScene& scene, scalar dt, int n );
+  
+  virtual std::string getName() const;
+
+private:
+  // a = -gradE(x,v)/m, zero on fixed degrees of freedom
+  void computeAcceleration( const TwoDScene& scene, const VectorXs& x, const VectorXs& v, VectorXs& a );
+
+  StepperWorkspace m_workspace;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef __ASSEMBLER_TEST_H__
+#define __ASSEMBLER_TEST_H__
+
+#include <gtest/gtest.h>
+
+#include "FOSSSim/TwoDScene.h"
+#include "FOSSSim/ImplicitSystemAssembler.h"
+
+namespace
+{
+  // A force type the assembler does not know. It couples two particles with
+  // a stiffness k*I, but only while they are closer than range, so its
+  // Hessian's nonzeros depend on the state.
+  class ProximityCoupling : public Force
+  {
+  public:
+    ProximityCoupling( int i, int j, scalar k, scalar range ) : m_i(i), m_j(j), m_k(k), m_range(range) {}
+
+    virtual void addEnergyToTotal( const VectorXs& x, const VectorXs& v, const VectorXs& m, scalar& E ) {}
+    virtual void addGradEToTotal( const VectorXs& x, const VectorXs& v, const VectorXs& m, VectorXs& gradE ) {}
+
+    virtual void addHessXToTotal( const VectorXs& x, const VectorXs& v, const VectorXs& m, MatrixXs& hessE )
+    {
+      if( ( x.segment<2>(2*m_i) - x.segment<2>(2*m_j) ).norm() >= m_range ) return;
+      hessE.block<2,2>(2*m_i,2*m_i) += m_k*Matrix2s::Identity();
+      hessE.block<2,2>(2*m_j,2*m_j) += m_k*Matrix2s::Identity();
+      hessE.block<2,2>(2*m_i,2*m_j) -= m_k*Matrix2s::Identity();
+      hessE.block<2,2>(2*m_j,2*m_i) -= m_k*Matrix2s::Identity();
+    }
+
+    virtual void addHessVToTotal( const VectorXs& x, const VectorXs& v, const VectorXs& m, MatrixXs& hessE ) {}
+
+    virtual Force* createNewCopy() { return new ProximityCoupling( *this ); }
+
+  private:
+    int m_i;
+    int m_j;
+    scalar m_k;
+    scalar m_range;
+  };
+
+  // M + cx*Hx, identity on fixed degrees of freedom
+  MatrixXs denseSystem( TwoDScene& scene, scalar cx )
+  {
+    const int ndof = scene.getX().size();
+    MatrixXs H = MatrixXs::Zero( ndof, ndof );
+    for( std::vector<Force*>::size_type f = 0; f < scene.getForces().size(); ++f )
+      scene.getForces()[f]->addHessXToTotal( scene.getX(), scene.getV(), scene.getM(), H );
+    MatrixXs A = cx*H;
+    A.diagonal() += scene.getM();
+    for( int d = 0; d < ndof; ++d )
+    {
+      if( !scene.isFixed(d/2) ) continue;
+      A.row(d).setZero();
+      A.col(d).setZero();
+      A(d,d) = 1.0;
+    }
+    return A;
+  }
+}
+
+// Forces the assembler only sees through their dense Hessians keep a stable
+// pattern: their nonzeros are probed when the pattern is built, and a
+// coupling that switches on later costs a single rebuild
+TEST(ImplicitSystemAssembler, StablePatternForUnknownForces)
+{
+  TwoDScene scene( 4 );
+  for( int i = 0; i < 4; ++i )
+  {
+    scene.setPosition( i, Vector2s( (scalar) i, 0.0 ) );
+    scene.setVelocity( i, Vector2s::Zero() );
+    scene.setMass( i, 1.0 + i );
+    scene.setFixed( i, false );
+  }
+  scene.insertForce( new ProximityCoupling( 0, 1, 10.0, 2.0 ) );
+  scene.insertForce( new ProximityCoupling( 2, 3, 20.0, 0.5 ) );
+
+  const scalar cx = 1.0e-4;
+  ImplicitSystemAssembler assembler;
+  Eigen::SparseMatrix<scalar> A;
+  assembler.assemble( scene, scene.getX(), scene.getV(), cx, 0.0, A );
+  const int version = assembler.getPatternVersion();
+  EXPECT_LT( ( MatrixXs( A ) - denseSystem( scene, cx ) ).lpNorm<Eigen::Infinity>(), 1.0e-14 );
+
+  for( int step = 0; step < 10; ++step ) assembler.assemble( scene, scene.getX(), scene.getV(), cx, 0.0, A );
+  EXPECT_EQ( version, assembler.getPatternVersion() );
+
+  // Particles 2 and 3 come into range
+  scene.setPosition( 3, Vector2s( 2.25, 0.0 ) );
+  assembler.assemble( scene, scene.getX(), scene.getV(), cx, 0.0, A );
+  EXPECT_EQ( version + 1, assembler.getPatternVersion() );
+  EXPECT_LT( ( MatrixXs( A ) - denseSystem( scene, cx ) ).lpNorm<Eigen::Infinity>(), 1.0e-14 );
+
+  // and out again; the entries stay in the pattern as explicit zeros
+  scene.setPosition( 3, Vector2s( 3.0, 0.0 ) );
+  for( int step = 0; step < 10; ++step ) assembler.assemble( scene, scene.getX(), scene.getV(), cx, 0.0, A );
+  EXPECT_EQ( version + 1, assembler.getPatternVersion() );
+  EXPECT_LT( ( MatrixXs( A ) - denseSystem( scene, cx ) ).lpNorm<Eigen::Infinity>(), 1.0e-14 );
+
+  // Fixing a particle changes the pattern once
+  scene.setFixed( 0, true );
+  assembler.assemble( scene, scene.getX(), scene.getV(), cx, 0.0, A );
+  assembler.assemble( scene, scene.getX(), scene.getV(), cx, 0.0, A );
+  EXPECT_EQ( version + 2, assembler.getPatternVersion() );
+  EXPECT_LT( ( MatrixXs( A ) - denseSystem( scene, cx ) ).lpNorm<Eigen::Infinity>(), 1.0e-14 );
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef __BANDED_SOLVER_TEST_H__
+#define __BANDED_SOLVER_TEST_H__
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "FOSSSim/TwoDScene.h"
+#include "FOSSSim/SpringForce.h"
+#include "FOSSSim/ImplicitSystemAssembler.h"
+#include "FOSSSim/BandedCholeskySolver.h"
+
+namespace
+{
+  // A two particle wide ribbon of springs, with rails, rungs and one
+  // diagonal per cell, whose particles are numbered in random order
+  void makeShuffledRibbon( TwoDScene& scene, int length )
+  {
+    std::vector<int> number( 2*length );
+    for( int p = 0; p < 2*length; ++p ) number[p] = p;
+    for( int p = 2*length - 1; p > 0; --p ) std::swap( number[p], number[std::rand()%( p + 1 )] );
+
+    const scalar spacing = 0.1;
+    scene.resizeSystem( 2*length );
+    for( int i = 0; i < length; ++i )
+    {
+      for( int side = 0; side < 2; ++side )
+      {
+        const int p = number[2*i + side];
+        scene.setPosition( p, Vector2s( 1.01*spacing*i, 1.02*spacing*side + 0.001*( i%3 ) ) );
+        scene.setVelocity( p, Vector2s::Zero() );
+        scene.setMass( p, 1.0 + 0.01*( i%7 ) );
+        scene.setFixed( p, false );
+        scene.setRadius( p, 0.01 );
+      }
+    }
+
+    const scalar k = 1.0e4;
+    for( int i = 0; i < length; ++i )
+    {
+      scene.insertForce( new SpringForce( std::pair<int,int>( number[2*i], number[2*i + 1] ), k, spacing, 1.0 ) );
+      if( i + 1 == length ) continue;
+      scene.insertForce( new SpringForce( std::pair<int,int>( number[2*i], number[2*i + 2] ), k, spacing, 1.0 ) );
+      scene.insertForce( new SpringForce( std::pair<int,int>( number[2*i + 1], number[2*i + 3] ), k, spacing, 1.0 ) );
+      scene.insertForce( new SpringForce( std::pair<int,int>( number[2*i], number[2*i + 3] ), k, std::sqrt(2.0)*spacing, 1.0 ) );
+    }
+  }
+}
+
+// Reverse Cuthill-McKee recovers the ribbon's narrow band however its
+// particles are numbered, and the band Cholesky solve agrees with a sparse
+// LDL^T to round off
+TEST(BandedCholeskySolver, MatchesSimplicialLDLT)
+{
+  std::srand( 1 );
+  TwoDScene scene;
+  makeShuffledRibbon( scene, 2000 );
+
+  const scalar dt = 0.01;
+  ImplicitSystemAssembler assembler;
+  Eigen::SparseMatrix<scalar> A;
+  assembler.assemble( scene, scene.getX(), scene.getV(), dt*dt, dt, A );
+
+  VectorXs b( A.rows() );
+  for( int d = 0; d < b.size(); ++d ) b(d) = std::sin( 0.37*d ) + 0.5;
+
+  BandedCholeskySolver banded;
+  ASSERT_TRUE( banded.compute( A ) );
+  EXPECT_TRUE( banded.isBanded() );
+  EXPECT_LE( banded.getBandwidth(), 8 );
+  VectorXs x;
+  banded.solve( b, x );
+
+  Eigen::SimplicialLDLT< Eigen::SparseMatrix<scalar> > ldlt( A );
+  ASSERT_EQ( Eigen::Success, ldlt.info() );
+  const VectorXs reference = ldlt.solve( b );
+  EXPECT_LT( ( x - reference ).lpNorm<Eigen::Infinity>(), 1.0e-13*reference.lpNorm<Eigen::Infinity>() );
+
+  // New values on the same pattern keep the ordering
+  assembler.assemble( scene, scene.getX(), scene.getV(), 4.0*dt*dt, 2.0*dt, A );
+  ASSERT_TRUE( banded.compute( A ) );
+  EXPECT_EQ( 1, banded.getNumOrderings() );
+  banded.solve( b, x );
+  ldlt.compute( A );
+  EXPECT_LT( ( x - ldlt.solve( b ) ).lpNorm<Eigen::Infinity>(), 1.0e-13*reference.lpNorm<Eigen::Infinity>() );
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef __PRECONDITIONER_TEST_H__
+#define __PRECONDITIONER_TEST_H__
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "FOSSSim/TwoDScene.h"
+#include "FOSSSim/SpringForce.h"
+#include "FOSSSim/ImplicitSystemAssembler.h"
+#include "FOSSSim/PreconditionedCGSolver.h"
+#include "SceneLoader.h"
+
+namespace
+{
+  const scalar kSolveTolerance = 1.0e-10;
+
+  const PreconditionedCGSolver::PreconditionerType kPreconditioners[] =
+  {
+    PreconditionedCGSolver::IDENTITY,
+    PreconditionedCGSolver::BLOCK_JACOBI,
+    PreconditionedCGSolver::INCOMPLETE_CHOLESKY
+  };
+  const char* const kPreconditionerNames[] = { "identity", "block Jacobi", "IC(0)" };
+
+  // Solves one linearized implicit Euler step, (M + dt^2 Hx + dt Hv) dv =
+  // -dt (gradU + dt Hx v), with each preconditioner. Prints the iteration
+  // counts and returns them in iterations.
+  void solveImplicitStep( const std::string& name, TwoDScene& scene, scalar dt, int* iterations )
+  {
+    ImplicitSystemAssembler assembler;
+    Eigen::SparseMatrix<scalar> A;
+    assembler.assemble( scene, scene.getX(), scene.getV(), dt*dt, dt, A );
+
+    // dt^2 Hx v, from a position-only assembly with the mass taken back out
+    ImplicitSystemAssembler position_assembler;
+    Eigen::SparseMatrix<scalar> Ax;
+    position_assembler.assemble( scene, scene.getX(), scene.getV(), dt*dt, 0.0, Ax );
+    VectorXs b = Ax*scene.getV();
+    VectorXs gradU = VectorXs::Zero( scene.getX().size() );
+    scene.accumulateGradU( gradU );
+    for( int d = 0; d < b.size(); ++d ) b(d) = scene.isFixed(d/2) ? 0.0 : -dt*gradU(d) - ( b(d) - scene.getM()(d)*scene.getV()(d) );
+
+    std::cout << std::setw(58) << std::left << name;
+    for( int p = 0; p < 3; ++p )
+    {
+      PreconditionedCGSolver solver( kPreconditioners[p], kSolveTolerance, 10*(int) b.size() );
+      solver.compute( A );
+      VectorXs dv = VectorXs::Zero( b.size() );
+      EXPECT_TRUE( solver.solve( b, dv ) ) << name << " with " << kPreconditionerNames[p];
+      iterations[p] = solver.getNumIterations();
+      std::cout << std::setw(14) << std::right << iterations[p];
+    }
+    std::cout << std::endl;
+  }
+
+  void printHeader()
+  {
+    std::cout << "CG iterations to a relative residual of " << kSolveTolerance << std::endl;
+    std::cout << std::setw(58) << std::left << "scene";
+    for( int p = 0; p < 3; ++p ) std::cout << std::setw(14) << std::right << kPreconditionerNames[p];
+    std::cout << std::endl;
+  }
+}
+
+// Iterations to tolerance on the first step of every spring and spring
+// damping scene. IC(0) should never need more iterations than plain CG.
+TEST(PreconditionedCG, SpringScenes)
+{
+  const char* const scenes[] =
+  {
+    "t1m3/SpringTests/test00linearizedimplicit.xml",
+    "t1m3/SpringTests/test01linearizedimplicit.xml",
+    "t1m3/SpringTests/test02linearizedimplicit.xml",
+    "t1m3/SpringTests/test03linearizedimplicit.xml",
+    "t1m3/SpringDampingTests/test00linearizedimplicit.xml",
+    "t1m3/SpringDampingTests/test01linearizedimplicit.xml",
+    "t1m3/SpringDampingTests/test02linearizedimplicit.xml",
+    "t1m3/SpringDampingTests/test03linearizedimplicit.xml",
+    "t1m3/SystemTests/MultiplePendulumLinearizedImplicit.xml"
+  };
+
+  printHeader();
+  for( unsigned s = 0; s < sizeof(scenes)/sizeof(scenes[0]); ++s )
+  {
+    TwoDScene scene;
+    scalar dt;
+    ASSERT_TRUE( loadScene( assetPath( scenes[s] ), scene, dt ) ) << scenes[s];
+
+    int iterations[3];
+    solveImplicitStep( scenes[s], scene, dt, iterations );
+    EXPECT_LE( iterations[2], iterations[0] ) << scenes[s];
+  }
+}
+
+// A stiff two particle wide ribbon, rotated off the axes and stretched, where
+// the preconditioners actually differ
+TEST(PreconditionedCG, RotatedRibbon)
+{
+  const int length = 1000;
+  const scalar spacing = 0.1;
+  const scalar angle = 0.5;
+  const Vector2s along( std::cos(angle), std::sin(angle) );
+  const Vector2s across( -std::sin(angle), std::cos(angle) );
+
+  TwoDScene scene;
+  scene.resizeSystem( 2*length );
+  for( int i = 0; i < length; ++i )
+  {
+    for( int side = 0; side < 2; ++side )
+    {
+      int p = 2*i + side;
+      scene.setPosition( p, 1.01*spacing*( i*along + side*across ) );
+      scene.setVelocity( p, Vector2s::Zero() );
+      scene.setMass( p, 1.0 );
+      scene.setFixed( p, i == 0 );
+      scene.setRadius( p, 0.01 );
+    }
+  }
+
+  // Rails, rungs and one diagonal per cell
+  const scalar k = 1.0e4;
+  for( int i = 0; i < length; ++i )
+  {
+    scene.insertForce( new SpringForce( std::pair<int,int>( 2*i, 2*i + 1 ), k, spacing, 1.0 ) );
+    if( i + 1 == length ) continue;
+    scene.insertForce( new SpringForce( std::pair<int,int>( 2*i, 2*i + 2 ), k, spacing, 1.0 ) );
+    scene.insertForce( new SpringForce( std::pair<int,int>( 2*i + 1, 2*i + 3 ), k, spacing, 1.0 ) );
+    scene.insertForce( new SpringForce( std::pair<int,int>( 2*i, 2*i + 3 ), k, std::sqrt(2.0)*spacing, 1.0 ) );
+  }
+
+  printHeader();
+  int iterations[3];
+  solveImplicitStep( "2x1000 rotated ribbon", scene, 0.01, iterations );
+  EXPECT_LT( iterations[2], iterations[0] );
+}
+
+// A NaN in the matrix can never be factored. The preconditioner has to give
+// up after a bounded number of shifted retries instead of looping forever.
+TEST(IncompleteCholesky, FallsBackOnNaN)
+{
+  Eigen::SparseMatrix<scalar> A( 4, 4 );
+  for( int d = 0; d < 4; ++d ) A.insert( d, d ) = 2.0;
+  A.insert( 1, 0 ) = A.insert( 0, 1 ) = std::numeric_limits<scalar>::quiet_NaN();
+  A.makeCompressed();
+
+  IncompleteCholeskyPreconditioner preconditioner;
+  preconditioner.compute( A );
+  EXPECT_TRUE( preconditioner.usesFallback() );
+
+  Eigen::SparseMatrix<scalar> B( 4, 4 );
+  for( int d = 0; d < 4; ++d ) B.insert( d, d ) = 2.0;
+  B.makeCompressed();
+  preconditioner.compute( B );
+  EXPECT_FALSE( preconditioner.usesFallback() );
+  EXPECT_EQ( 0.0, preconditioner.getShift() );
+}
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef __STEPPER_TEST_H__
+#define __STEPPER_TEST_H__
+
+#include <gtest/gtest.h>
+
+#include "FOSSSim/TwoDScene.h"
+#include "FOSSSim/SpringForce.h"
+#include "FOSSSim/VelocityVerlet.h"
+#include "FOSSSim/RungeKutta4.h"
+#include "FOSSSim/MultirateStepper.h"
+
+namespace
+{
+  // Forwards to a wrapped force and counts the gradient evaluations
+  class CountingForce : public Force
+  {
+  public:
+    CountingForce( Force* force, int* count ) : m_force(force), m_count(count) {}
+    virtual ~CountingForce() { delete m_force; }
+
+    virtual void addEnergyToTotal( const VectorXs& x, const VectorXs& v, const VectorXs& m, scalar& E ) { m_force->addEnergyToTotal( x, v, m, E ); }
+    virtual void addGradEToTotal( const VectorXs& x, const VectorXs& v, const VectorXs& m, VectorXs& gradE ) { ++*m_count; m_force->addGradEToTotal( x, v, m, gradE ); }
+    virtual void addHessXToTotal( const VectorXs& x, const VectorXs& v, const VectorXs& m, MatrixXs& hessE ) { m_force->addHessXToTotal( x, v, m, hessE ); }
+    virtual void addHessVToTotal( const VectorXs& x, const VectorXs& v, const VectorXs& m, MatrixXs& hessE ) { m_force->addHessVToTotal( x, v, m, hessE ); }
+    virtual Force* createNewCopy() { return new CountingForce( m_force->createNewCopy(), m_count ); }
+
+  private:
+    Force* m_force;
+    int* m_count;
+  };
+
+  // A chain of undamped springs, stretched so that it oscillates
+  void makeChain( TwoDScene& scene, int n, int* count )
+  {
+    scene.resizeSystem( n );
+    for( int i = 0; i < n; ++i )
+    {
+      scene.setPosition( i, Vector2s( 1.1*i, 0.05*( i%2 ) ) );
+      scene.setVelocity( i, Vector2s( 0.0, 0.1*i ) );
+      scene.setMass( i, 1.0 + 0.1*i );
+      scene.setFixed( i, false );
+    }
+    for( int i = 0; i + 1 < n; ++i ) scene.insertForce( new CountingForce( new SpringForce( std::pair<int,int>( i, i + 1 ), 50.0, 1.0 ), count ) );
+  }
+}
+
+// Velocity Verlet reuses each step's closing acceleration for the next
+// step's opening half kick. With position only forces that gives bit for bit
+// the result of recomputing it, at one force evaluation per step.
+TEST(VelocityVerlet, ReusesClosingAcceleration)
+{
+  const int n = 5;
+  const int nsteps = 50;
+  const scalar dt = 0.01;
+
+  int cached_count = 0;
+  TwoDScene cached;
+  makeChain( cached, n, &cached_count );
+
+  int fresh_count = 0;
+  TwoDScene fresh;
+  makeChain( fresh, n, &fresh_count );
+
+  VelocityVerlet stepper;
+  for( int step = 0; step < nsteps; ++step )
+  {
+    stepper.stepScene( cached, dt );
+    VelocityVerlet once;
+    once.stepScene( fresh, dt );
+    ASSERT_TRUE( cached.getX() == fresh.getX() ) << "step " << step;
+    ASSERT_TRUE( cached.getV() == fresh.getV() ) << "step " << step;
+  }
+
+  const int nsprings = n - 1;
+  EXPECT_EQ( nsprings*( nsteps + 1 ), cached_count );
+  EXPECT_EQ( nsprings*2*nsteps, fresh_count );
+}
+
+// Changing the velocities or the fixed set between steps makes the stepper
+// evaluate the forces afresh
+TEST(VelocityVerlet, RecomputesAfterOutsideChanges)
+{
+  const scalar dt = 0.01;
+  int count = 0;
+  TwoDScene scene;
+  makeChain( scene, 3, &count );
+  const int nsprings = 2;
+
+  VelocityVerlet stepper;
+  stepper.stepScene( scene, dt );
+  stepper.stepScene( scene, dt );
+  EXPECT_EQ( nsprings*3, count );
+
+  scene.getV() *= -1.0;
+  stepper.stepScene( scene, dt );
+  EXPECT_EQ( nsprings*5, count );
+
+  scene.setFixed( 0, true );
+  stepper.stepScene( scene, dt );
+  EXPECT_EQ( nsprings*7, count );
+
+  stepper.stepScene( scene, dt );
+  EXPECT_EQ( nsprings*8, count );
+}
+
+// stepSceneN prepares once for all its steps, and otherwise takes exactly
+// the steps stepScene would
+TEST(VelocityVerlet, StepSceneNMatchesStepScene)
+{
+  const int nsteps = 40;
+  const scalar dt = 0.01;
+
+  int single_count = 0;
+  TwoDScene single;
+  makeChain( single, 4, &single_count );
+  VelocityVerlet single_stepper;
+  for( int step = 0; step < nsteps; ++step ) single_stepper.stepScene( single, dt );
+
+  int batched_count = 0;
+  TwoDScene batched;
+  makeChain( batched, 4, &batched_count );
+  VelocityVerlet batched_stepper;
+  EXPECT_TRUE( batched_stepper.stepSceneN( batched, dt, nsteps/2 ) );
+  EXPECT_TRUE( batched_stepper.stepSceneN( batched, dt, nsteps/2 ) );
+
+  EXPECT_TRUE( single.getX() == batched.getX() );
+  EXPECT_TRUE( single.getV() == batched.getV() );
+  EXPECT_EQ( single_count, batched_count );
+}
+
+TEST(RungeKutta4, StepSceneNMatchesStepScene)
+{
+  const int nsteps = 40;
+  const scalar dt = 0.01;
+
+  int single_count = 0;
+  TwoDScene single;
+  makeChain( single, 4, &single_count );
+  RungeKutta4 single_stepper;
+  for( int step = 0; step < nsteps; ++step ) single_stepper.stepScene( single, dt );
+
+  int batched_count = 0;
+  TwoDScene batched;
+  makeChain( batched, 4, &batched_count );
+  RungeKutta4 batched_stepper;
+  EXPECT_TRUE( batched_stepper.stepSceneN( batched, dt, nsteps ) );
+
+  EXPECT_TRUE( single.getX() == batched.getX() );
+  EXPECT_TRUE( single.getV() == batched.getV() );
+  EXPECT_EQ( 3*4*nsteps, batched_count );
+}
+
+// The multirate partition follows the fixed flags, masses and tags. A spring
+// with a fixed endpoint oscillates at sqrt(k/m); freeing the endpoint halves
+// the effective mass, which here takes it past the stability fraction.
+TEST(MultirateStepper, RepartitionsOnSceneChanges)
+{
+  const scalar dt = 0.01;
+  TwoDScene scene( 2 );
+  scene.setPosition( 0, Vector2s( 0.0, 0.0 ) );
+  scene.setPosition( 1, Vector2s( 1.0, 0.0 ) );
+  for( int i = 0; i < 2; ++i )
+  {
+    scene.setVelocity( i, Vector2s::Zero() );
+    scene.setMass( i, 1.0 );
+  }
+  scene.setFixed( 0, true );
+  scene.setFixed( 1, false );
+  scene.insertForce( new SpringForce( std::pair<int,int>( 0, 1 ), 1600.0, 1.0 ) );
+
+  // dt*sqrt(k/m) = 0.4, under the default fraction of 0.5
+  MultirateStepper stepper;
+  stepper.stepScene( scene, dt );
+  EXPECT_EQ( 0u, stepper.getFastForces().size() );
+  EXPECT_EQ( 1, stepper.getNumSubsteps() );
+
+  // dt*sqrt(2k/m) is about 0.57
+  scene.setFixed( 0, false );
+  stepper.stepScene( scene, dt );
+  EXPECT_EQ( 1u, stepper.getFastForces().size() );
+  EXPECT_EQ( 2, stepper.getNumSubsteps() );
+
+  // Heavier particles bring it back under
+  scene.setMass( 0, 4.0 );
+  scene.setMass( 1, 4.0 );
+  stepper.stepScene( scene, dt );
+  EXPECT_EQ( 0u, stepper.getFastForces().size() );
+
+  // unless an endpoint is tagged stiff
+  scene.getParticleTags().resize( 2 );
+  scene.getParticleTags()[1] = "stiff";
+  stepper.stepScene( scene, dt );
+  EXPECT_EQ( 1u, stepper.getFastForces().size() );
+  EXPECT_EQ( 1, stepper.getNumSubsteps() );
+}
+
+#endif
@@ -0,0 +1,14 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "AssemblerTest.h"
+#include "BandedSolverTest.h"
+#include "PreconditionerTest.h"
+#include "StepperTest.h"
+
+
+int main( int argc, char **argv ) 
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
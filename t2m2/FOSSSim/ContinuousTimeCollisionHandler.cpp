@@ -1,7 +1,22 @@
 #include "ContinuousTimeCollisionHandler.h"
 #include <iostream>
+#include <limits>
+#include <algorithm>
 #include "ContinuousTimeUtilities.h"
 
+namespace
+{
+    // Shared by the detect functions for pairs a filter rejected. The pair
+    // still records its polynomials, which the simulation compares against
+    // the oracle each step, but skips the solve and reports no collision.
+    bool rejectFilteredPair(const std::vector<Polynomial> &polynomials, double &time)
+    {
+        PolynomialIntervalSolver::recordPolynomials(polynomials);
+        time = std::numeric_limits<double>::infinity();
+        return false;
+    }
+}
+
 // BEGIN STUDENT CODE //
 
 
@@ -28,6 +43,8 @@
 //   during the motion.
 bool ContinuousTimeCollisionHandler::detectParticleParticle(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int idx1, int idx2, Vector2s &n, double &time)
 {
+    bool separated = particleParticleSeparated(scene, qs, qe, idx1, idx2);
+    
     VectorXs dx = qe-qs;
     
     VectorXs x1 = qs.segment<2>(2*idx1);
@@ -49,6 +66,9 @@ bool ContinuousTimeCollisionHandler::detectParticleParticle(const TwoDScene &sce
     polynomials.push_back(Polynomial(position_polynomial));
     polynomials.push_back(Polynomial(velocity_polynomial));
     
+    if(separated)
+        return rejectFilteredPair(polynomials, time);
+    
     time = PolynomialIntervalSolver::findFirstIntersectionTime(polynomials);
     
     // Your implementation here should compute n, and examine time to decide the return value
@@ -103,6 +123,8 @@ bool ContinuousTimeCollisionHandler::detectParticleParticle(const TwoDScene &sce
 // objects were overlapping and approaching at any point during that motion.
 bool ContinuousTimeCollisionHandler::detectParticleEdge(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int vidx, int eidx, Vector2s &n, double &time)
 {
+    bool separated = particleEdgeSeparated(scene, qs, qe, vidx, eidx);
+    
     VectorXs dx = qe - qs;
     
     VectorXs x1 = qs.segment<2>(2*vidx);
@@ -158,6 +180,9 @@ bool ContinuousTimeCollisionHandler::detectParticleEdge(const TwoDScene &scene,
     polynomials.push_back(Polynomial(alpha_less_than_one_polynomial));
     polynomials.push_back(Polynomial(velcity_polynomial));
     
+    if(separated)
+        return rejectFilteredPair(polynomials, time);
+    
     time = PolynomialIntervalSolver::findFirstIntersectionTime(polynomials);
     
     // Your implementation here should compute n, and examine time to decide the return value
@@ -190,6 +215,8 @@ bool ContinuousTimeCollisionHandler::detectParticleEdge(const TwoDScene &scene,
 // objects were overlapping and approaching at any point during that motion.
 bool ContinuousTimeCollisionHandler::detectParticleHalfplane(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int vidx, int pidx, Vector2s &n, double &time)
 {
+    bool separated = particleHalfplaneSeparated(scene, qs, qe, vidx, pidx);
+    
     VectorXs dx = qe - qs;
     
     VectorXs x1 = qs.segment<2>(2*vidx);
@@ -210,6 +237,9 @@ bool ContinuousTimeCollisionHandler::detectParticleHalfplane(const TwoDScene &sc
     polynomials.push_back(Polynomial(position_polynomial));
     polynomials.push_back(Polynomial(velocity_polynomial));
     
+    if(separated)
+        return rejectFilteredPair(polynomials, time);
+    
     time = PolynomialIntervalSolver::findFirstIntersectionTime(polynomials);
     
     // Your implementation here should compute n, and examine time to decide the return value
@@ -217,4 +247,209 @@ bool ContinuousTimeCollisionHandler::detectParticleHalfplane(const TwoDScene &sc
     return false;
 }
 
+CCDFilterStats ContinuousTimeCollisionHandler::s_pp_filter_stats;
+CCDFilterStats ContinuousTimeCollisionHandler::s_pe_filter_stats;
+CCDFilterStats ContinuousTimeCollisionHandler::s_ph_filter_stats;
 
+namespace
+{
+    // Slack on the contact distance, so that grazing contacts the polynomial
+    // solve could still report within its tolerances are never filtered out.
+    const double kFilterRelativeSlack = 1e-6;
+    const double kFilterAbsoluteSlack = 1e-12;
+    
+    double inflatedRadius(double r)
+    {
+        return r*(1.0 + kFilterRelativeSlack) + kFilterAbsoluteSlack;
+    }
+    
+    double cross(const Vector2s &a, const Vector2s &b)
+    {
+        return a.x()*b.y() - a.y()*b.x();
+    }
+    
+    // True if the bounding box of the points lies entirely outside [-r, r]
+    // along either axis.
+    bool boundsSeparated(const Vector2s *points, int npoints, double r)
+    {
+        Vector2s lo = points[0];
+        Vector2s hi = points[0];
+        for(int i = 1; i < npoints; ++i)
+        {
+            lo = lo.cwiseMin(points[i]);
+            hi = hi.cwiseMax(points[i]);
+        }
+        return lo.x() > r || lo.y() > r || hi.x() < -r || hi.y() < -r;
+    }
+    
+    // Smallest |a + b t + c t^2| over t in [0, 1], or zero if the quadratic
+    // changes sign there.
+    double minAbsQuadratic(double a, double b, double c)
+    {
+        double lo = std::min(a, a + b + c);
+        double hi = std::max(a, a + b + c);
+        if(c != 0.0)
+        {
+            double t = -b/(2.0*c);
+            if(t > 0.0 && t < 1.0)
+            {
+                double v = a + t*(b + c*t);
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            }
+        }
+        if(lo <= 0.0 && hi >= 0.0)
+            return 0.0;
+        return std::min(fabs(lo), fabs(hi));
+    }
+    
+    // Distance from the origin to the segment from a to b.
+    double originSegmentDistance(const Vector2s &a, const Vector2s &b)
+    {
+        Vector2s e = b - a;
+        double len2 = e.squaredNorm();
+        double alpha = len2 > 0.0 ? std::max(0.0, std::min(1.0, -a.dot(e)/len2)) : 0.0;
+        return (a + alpha*e).norm();
+    }
+    
+    void reportQueryStats(std::ostream &os, const char *query, const CCDFilterStats &stats)
+    {
+        os << query << ": " << stats.m_tested << " tested, " << stats.rejected() << " rejected ("
+           << stats.m_swept_bounds << " swept bounds, " << stats.m_relative_velocity << " relative velocity, "
+           << stats.m_travel_bound << " travel bound, " << stats.m_distance_bound << " distance bound)" << std::endl;
+    }
+}
+
+// The separation d(t) = d0 + t dv traces a segment over the step. Rejects if
+// that segment's bounds miss the contact disc, if d.dv never goes negative
+// (the particles never approach), or if its closest approach stays outside
+// the contact distance.
+bool ContinuousTimeCollisionHandler::particleParticleSeparated(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int idx1, int idx2)
+{
+    CCDFilterStats &stats = s_pp_filter_stats;
+    ++stats.m_tested;
+    
+    Vector2s d0 = qs.segment<2>(2*idx2) - qs.segment<2>(2*idx1);
+    Vector2s dv = (qe.segment<2>(2*idx2) - qs.segment<2>(2*idx2)) - (qe.segment<2>(2*idx1) - qs.segment<2>(2*idx1));
+    double r = inflatedRadius(scene.getRadius(idx1) + scene.getRadius(idx2));
+    
+    Vector2s sweep[2] = {d0, d0 + dv};
+    if(boundsSeparated(sweep, 2, r))
+    {
+        ++stats.m_swept_bounds;
+        return true;
+    }
+    
+    double approach = d0.dot(dv);
+    if(approach > 0.0)
+    {
+        ++stats.m_relative_velocity;
+        return true;
+    }
+    
+    double t = approach < 0.0 ? std::min(1.0, -approach/dv.squaredNorm()) : 0.0;
+    if((d0 + t*dv).squaredNorm() > r*r)
+    {
+        ++stats.m_distance_bound;
+        return true;
+    }
+    
+    return false;
+}
+
+// Works relative to the particle, where every point of the moving edge lies
+// in the hull of its four start and end endpoint positions. Rejects if those
+// bounds miss the contact disc, if the start distance exceeds the contact
+// distance by more than the endpoints can move, or if an interval bound on
+// the distance to the edge's line stays outside the contact distance.
+bool ContinuousTimeCollisionHandler::particleEdgeSeparated(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int vidx, int eidx)
+{
+    CCDFilterStats &stats = s_pe_filter_stats;
+    ++stats.m_tested;
+    
+    int i2 = scene.getEdge(eidx).first;
+    int i3 = scene.getEdge(eidx).second;
+    
+    Vector2s a0 = qs.segment<2>(2*i2) - qs.segment<2>(2*vidx);
+    Vector2s a1 = qe.segment<2>(2*i2) - qe.segment<2>(2*vidx);
+    Vector2s b0 = qs.segment<2>(2*i3) - qs.segment<2>(2*vidx);
+    Vector2s b1 = qe.segment<2>(2*i3) - qe.segment<2>(2*vidx);
+    double r = inflatedRadius(scene.getRadius(vidx) + scene.getEdgeRadii()[eidx]);
+    
+    Vector2s sweep[4] = {a0, a1, b0, b1};
+    if(boundsSeparated(sweep, 4, r))
+    {
+        ++stats.m_swept_bounds;
+        return true;
+    }
+    
+    // Each point of the edge moves relative to the particle no faster than
+    // the faster of its endpoints.
+    double travel = std::max((a1 - a0).norm(), (b1 - b0).norm());
+    if(originSegmentDistance(a0, b0) - travel > r)
+    {
+        ++stats.m_travel_bound;
+        return true;
+    }
+    
+    // The distance to the line is |cross(a, e)|/|e|. The cross product is a
+    // quadratic in t, and |e(t)| peaks at an end of the step.
+    Vector2s da = a1 - a0;
+    Vector2s e0 = b0 - a0;
+    Vector2s de = (b1 - a1) - e0;
+    double cmin = minAbsQuadratic(cross(a0, e0), cross(a0, de) + cross(da, e0), cross(da, de));
+    double emax = std::max(e0.norm(), (b1 - a1).norm());
+    if(cmin > r*emax)
+    {
+        ++stats.m_distance_bound;
+        return true;
+    }
+    
+    return false;
+}
+
+// The signed distance along the half-plane's normal is linear over the step.
+// Rejects if the particle moves away from the plane, or stays beyond the
+// contact distance at both ends of the step.
+bool ContinuousTimeCollisionHandler::particleHalfplaneSeparated(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int vidx, int pidx)
+{
+    CCDFilterStats &stats = s_ph_filter_stats;
+    ++stats.m_tested;
+    
+    Vector2s xp = scene.getHalfplane(pidx).first;
+    Vector2s np = scene.getHalfplane(pidx).second;
+    Vector2s x1 = qs.segment<2>(2*vidx);
+    Vector2s dx1 = qe.segment<2>(2*vidx) - x1;
+    
+    double s0 = (x1 - xp).dot(np);
+    double ds = dx1.dot(np);
+    double r = inflatedRadius(scene.getRadius(vidx))*np.norm();
+    
+    if(std::min(s0, s0 + ds) > r)
+    {
+        ++stats.m_swept_bounds;
+        return true;
+    }
+    
+    if(ds > 0.0)
+    {
+        ++stats.m_relative_velocity;
+        return true;
+    }
+    
+    return false;
+}
+
+void ContinuousTimeCollisionHandler::resetFilterStats()
+{
+    s_pp_filter_stats = CCDFilterStats();
+    s_pe_filter_stats = CCDFilterStats();
+    s_ph_filter_stats = CCDFilterStats();
+}
+
+void ContinuousTimeCollisionHandler::reportFilterStats(std::ostream &os)
+{
+    reportQueryStats(os, "particle-particle", s_pp_filter_stats);
+    reportQueryStats(os, "particle-edge", s_pe_filter_stats);
+    reportQueryStats(os, "particle-halfplane", s_ph_filter_stats);
+}
@@ -5,6 +5,21 @@
 #include <vector>
 #include <iostream>
 
+// Counts for one kind of detection query: how many candidates were tested and
+// how many each conservative filter rejected before the polynomial solve.
+struct CCDFilterStats
+{
+    CCDFilterStats() : m_tested(0), m_swept_bounds(0), m_relative_velocity(0), m_travel_bound(0), m_distance_bound(0) {}
+    
+    long rejected() const { return m_swept_bounds + m_relative_velocity + m_travel_bound + m_distance_bound; }
+    
+    long m_tested;
+    long m_swept_bounds;
+    long m_relative_velocity;
+    // Particle-edge pairs further apart at the start than the endpoints can travel
+    long m_travel_bound;
+    long m_distance_bound;
+};
 
 class ContinuousTimeCollisionHandler : public CollisionHandler
 {
@@ -25,6 +40,25 @@ public:
     void respondParticleEdge        (const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int vidx, int eidx, const Vector2s &n, double time, double dt, VectorXs &qm, VectorXs &qdotm);
     void respondParticleHalfplane   (const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int vidx, int pidx, const Vector2s &n, double time, double dt, VectorXs &qm, VectorXs &qdotm);
     
+    // Conservative early-outs run before the polynomial solve. Each returns
+    // true only if the pair provably cannot touch while approaching during
+    // the step, so a rejected pair never hides a collision.
+    static bool particleParticleSeparated   (const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int idx1, int idx2);
+    static bool particleEdgeSeparated       (const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int vidx, int eidx);
+    static bool particleHalfplaneSeparated  (const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int vidx, int pidx);
+    
+    static const CCDFilterStats &getParticleParticleFilterStats()   { return s_pp_filter_stats; }
+    static const CCDFilterStats &getParticleEdgeFilterStats()       { return s_pe_filter_stats; }
+    static const CCDFilterStats &getParticleHalfplaneFilterStats()  { return s_ph_filter_stats; }
+    static void resetFilterStats();
+    // Writes one line per query kind with the tested and rejected counts
+    static void reportFilterStats(std::ostream &os);
+    
+private:
+    // Statics, since the simulation allocates this handler with a fixed layout.
+    static CCDFilterStats s_pp_filter_stats;
+    static CCDFilterStats s_pe_filter_stats;
+    static CCDFilterStats s_ph_filter_stats;
 };
 
 #endif
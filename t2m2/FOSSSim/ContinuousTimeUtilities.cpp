@@ -0,0 +1,519 @@
+#include "ContinuousTimeUtilities.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+std::vector<Polynomial> PolynomialIntervalSolver::s_polynomials;
+
+namespace
+{
+    // Complex roots whose imaginary part is below this are treated as real.
+    const double kImaginaryTolerance = 1e-8;
+
+    // Leading coefficients smaller than this are dropped from a polynomial.
+    const double kLeadingCoeffTolerance = 1e-12;
+
+    // Iteration cap for the bracketed cubic root search. Safeguarded Newton
+    // normally converges in a handful of steps; the cap only matters for
+    // pathological coefficient ranges where it falls back to bisection.
+    const int kMaxRootIterations = 100;
+
+    // RootFinder keeps fixed-size scratch arrays, which cap it at degree six.
+    const int kMaxDegree = 6;
+
+    // Insertion sort; there are never more than kMaxDegree roots.
+    void sortRoots(double *roots, int n)
+    {
+        for(int i = 1; i < n; ++i)
+        {
+            double r = roots[i];
+            int j = i;
+            for(; j > 0 && r < roots[j-1]; --j)
+                roots[j] = roots[j-1];
+            roots[j] = r;
+        }
+    }
+
+    // Real roots of c[0] t^2 + c[1] t + c[2] with c[0] != 0 and c[2] != 0.
+    // This is the same cancellation-free evaluation RootFinder::quad uses, so
+    // the roots match the Jenkins-Traub path bit for bit.
+    int solveQuadratic(const double *c, double *roots)
+    {
+        double a = c[0];
+        double b = c[1]/2.0;
+        double d, e;
+        if(fabs(b) < fabs(c[2]))
+        {
+            e = (c[2] < 0.0) ? -a : a;
+            e = b*(b/fabs(c[2])) - e;
+            d = sqrt(fabs(e))*sqrt(fabs(c[2]));
+        }
+        else
+        {
+            e = 1.0 - (a/b)*(c[2]/b);
+            d = sqrt(fabs(e))*fabs(b);
+        }
+
+        // A complex pair has imaginary part |d/a|.
+        if(e < 0.0)
+        {
+            if(!(fabs(d/a) < kImaginaryTolerance))
+                return 0;
+            roots[0] = roots[1] = -b/a;
+            return 2;
+        }
+
+        if(b >= 0.0)
+            d = -d;
+        double lr = (-b + d)/a;
+        roots[0] = (lr != 0.0) ? (c[2]/lr)/a : 0.0;
+        roots[1] = lr;
+        return 2;
+    }
+
+    double evaluateCubic(const double *c, double t)
+    {
+        return ((c[0]*t + c[1])*t + c[2])*t + c[3];
+    }
+
+    // Rounding error bound of evaluateCubic at t; residuals below it are
+    // indistinguishable from zero.
+    double cubicNoise(const double *c, double t)
+    {
+        double at = fabs(t);
+        return 8.0*std::numeric_limits<double>::epsilon()*(((fabs(c[0])*at + fabs(c[1]))*at + fabs(c[2]))*at + fabs(c[3]));
+    }
+
+    // Root of the cubic in [lo, hi], across which it is monotone and changes
+    // sign (negativeAtLo gives the sign at lo), by Newton's method started at
+    // guess and kept inside the bracket; steps that would leave it bisect
+    // instead.
+    double bracketCubicRoot(const double *c, double lo, double hi, bool negativeAtLo, double guess)
+    {
+        double t = (guess > lo && guess < hi) ? guess : 0.5*(lo + hi);
+        for(int i = 0; i < kMaxRootIterations; ++i)
+        {
+            double f = evaluateCubic(c, t);
+            if(fabs(f) <= cubicNoise(c, t))
+                return t;
+            if((f < 0.0) == negativeAtLo)
+                lo = t;
+            else
+                hi = t;
+
+            double df = (3.0*c[0]*t + 2.0*c[1])*t + c[2];
+            double tn = t - f/df;
+            if(!(tn > lo && tn < hi))
+                tn = 0.5*(lo + hi);
+            if(fabs(tn - t) <= std::numeric_limits<double>::epsilon()*fabs(t) || tn == lo || tn == hi)
+                return tn;
+            t = tn;
+        }
+        return t;
+    }
+
+    // Real roots of c[0] t^3 + c[1] t^2 + c[2] t + c[3] with c[0] != 0 and
+    // c[3] != 0. The critical points split the real line into monotone
+    // pieces, each holding a root exactly when the cubic changes sign across
+    // it, so every real root is bracketed and refined until its residual is
+    // at rounding level, even where the closed form cancels badly (tiny
+    // leading coefficients). The closed form only seeds the search.
+    int solveCubic(const double *c, double *roots)
+    {
+        // Closed-form estimates, following the trigonometric / Cardano split
+        // of Numerical Recipes.
+        double a = c[1]/c[0];
+        double b = c[2]/c[0];
+        double d = c[3]/c[0];
+        double Q = (a*a - 3.0*b)/9.0;
+        double R = (2.0*a*a*a - 9.0*a*b + 27.0*d)/54.0;
+        double R2 = R*R;
+        double Q3 = Q*Q*Q;
+        double shift = a/3.0;
+
+        double guesses[3];
+        int nguesses = 0;
+        if(R2 < Q3)
+        {
+            double theta = acos(std::max(-1.0, std::min(1.0, R/sqrt(Q3))));
+            double scale = -2.0*sqrt(Q);
+            guesses[nguesses++] = scale*cos(theta/3.0) - shift;
+            guesses[nguesses++] = scale*cos((theta + 2.0*M_PI)/3.0) - shift;
+            guesses[nguesses++] = scale*cos((theta - 2.0*M_PI)/3.0) - shift;
+        }
+        else
+        {
+            double A = -cbrt(fabs(R) + sqrt(R2 - Q3));
+            if(R < 0.0)
+                A = -A;
+            double B = (A == 0.0) ? 0.0 : Q/A;
+            guesses[nguesses++] = (A + B) - shift;
+        }
+
+        // Every root lies within the Cauchy bound.
+        double bound = 1.0 + std::max(fabs(c[1]), std::max(fabs(c[2]), fabs(c[3])))/fabs(c[0]);
+
+        // Critical points from the derivative 3 c0 t^2 + 2 c1 t + c2, using
+        // the cancellation-free form of the quadratic formula.
+        double ends[4];
+        int nends = 0;
+        ends[nends++] = -bound;
+        double disc = c[1]*c[1] - 3.0*c[0]*c[2];
+        if(disc > 0.0)
+        {
+            double q = -(c[1] + (c[1] < 0.0 ? -sqrt(disc) : sqrt(disc)));
+            double k1 = q/(3.0*c[0]);
+            double k2 = c[2]/q;
+            ends[nends++] = std::max(-bound, std::min(bound, std::min(k1, k2)));
+            ends[nends++] = std::max(-bound, std::min(bound, std::max(k1, k2)));
+        }
+        ends[nends++] = bound;
+
+        int nroots = 0;
+        for(int i = 0; i + 1 < nends; ++i)
+        {
+            double lo = ends[i];
+            double hi = ends[i+1];
+            double flo = evaluateCubic(c, lo);
+            double fhi = evaluateCubic(c, hi);
+            if(fhi == 0.0 && i + 2 < nends)
+            {
+                // A critical point that is itself a (repeated) root.
+                roots[nroots++] = hi;
+                continue;
+            }
+            if(!((flo < 0.0 && fhi > 0.0) || (flo > 0.0 && fhi < 0.0)))
+                continue;
+
+            double guess = 0.5*(lo + hi);
+            for(int j = 0; j < nguesses; ++j)
+                if(guesses[j] > lo && guesses[j] < hi)
+                    guess = guesses[j];
+            roots[nroots++] = bracketCubicRoot(c, lo, hi, flo < 0.0, guess);
+        }
+        return nroots;
+    }
+}
+
+bool overlap(const Interval &a, const Interval &b)
+{
+    return a.m_e >= b.m_s && b.m_e >= a.m_s;
+}
+
+Interval Iunion(const Interval &a, const Interval &b)
+{
+    return Interval(std::min(a.m_s, b.m_s), std::max(a.m_e, b.m_e));
+}
+
+Interval Iintersect(const Interval &a, const Interval &b)
+{
+    return Interval(std::max(a.m_s, b.m_s), std::min(a.m_e, b.m_e));
+}
+
+Intervals::Intervals(const std::vector<Interval> &intervals): m_size(0)
+{
+    for(std::vector<Interval>::const_iterator it = intervals.begin(); it != intervals.end(); ++it)
+        append(*it);
+    sortAndConsolidate();
+}
+
+Intervals::Intervals(const Intervals &other): m_spill(other.m_spill), m_size(other.m_size)
+{
+    if(m_spill.empty())
+        std::copy(other.m_inline, other.m_inline + m_size, m_inline);
+}
+
+Intervals &Intervals::operator=(const Intervals &other)
+{
+    if(this != &other)
+    {
+        m_size = other.m_size;
+        if(other.m_spill.empty())
+        {
+            m_spill.clear();
+            std::copy(other.m_inline, other.m_inline + m_size, m_inline);
+        }
+        else
+        {
+            m_spill = other.m_spill;
+        }
+    }
+    return *this;
+}
+
+void Intervals::append(const Interval &interval)
+{
+    if(!m_spill.empty())
+    {
+        m_spill.push_back(interval);
+    }
+    else if(m_size < kInlineCapacity)
+    {
+        m_inline[m_size] = interval;
+    }
+    else
+    {
+        m_spill.assign(m_inline, m_inline + m_size);
+        m_spill.push_back(interval);
+    }
+    ++m_size;
+}
+
+void Intervals::sortAndConsolidate()
+{
+    std::sort(data(), data() + m_size);
+    consolidateIntervals();
+}
+
+double Intervals::findNextSatTime(double t) const
+{
+    const Interval *intervals = data();
+    for(int i = 0; i < m_size; ++i)
+    {
+        if(t < intervals[i].m_e)
+            return std::max(intervals[i].m_s, t);
+    }
+    return std::numeric_limits<double>::infinity();
+}
+
+// Merges overlapping neighbours of the sorted list in place.
+void Intervals::consolidateIntervals()
+{
+    if(m_size == 0)
+        return;
+    
+    Interval *intervals = data();
+    int last = 0;
+    for(int i = 1; i < m_size; ++i)
+    {
+        if(overlap(intervals[last], intervals[i]))
+            intervals[last] = Iunion(intervals[last], intervals[i]);
+        else
+            intervals[++last] = intervals[i];
+    }
+    m_size = last + 1;
+    if(!m_spill.empty())
+        m_spill.resize(m_size);
+}
+
+Intervals intersect(const Intervals &i1, const Intervals &i2)
+{
+    Intervals result;
+    intersect(i1, i2, result);
+    return result;
+}
+
+// Both inputs are sorted and disjoint, so a single merge-style sweep finds
+// every overlapping pair, and the pieces come out sorted and disjoint too.
+void intersect(const Intervals &i1, const Intervals &i2, Intervals &result)
+{
+    assert(&result != &i1 && &result != &i2);
+    result.clear();
+    
+    const Interval *a = i1.data();
+    const Interval *b = i2.data();
+    int i = 0;
+    int j = 0;
+    while(i < i1.m_size && j < i2.m_size)
+    {
+        if(overlap(a[i], b[j]))
+            result.append(Iintersect(a[i], b[j]));
+        if(a[i].m_e < b[j].m_e)
+            ++i;
+        else
+            ++j;
+    }
+}
+
+double findNextSatTime(const Intervals &i1, const Intervals &i2, double t)
+{
+    int i = 0;
+    int j = 0;
+    while(i < i1.size() && j < i2.size())
+    {
+        if(overlap(i1[i], i2[j]))
+        {
+            Interval piece = Iintersect(i1[i], i2[j]);
+            if(t < piece.m_e)
+                return std::max(piece.m_s, t);
+        }
+        if(i1[i].m_e < i2[j].m_e)
+            ++i;
+        else
+            ++j;
+    }
+    return std::numeric_limits<double>::infinity();
+}
+
+std::ostream &operator<<(std::ostream &os, const Intervals &inter)
+{
+    os << "[";
+    for(int i = 0; i < inter.size(); ++i)
+    {
+        if(i > 0)
+            os << ", ";
+        os << "(" << inter[i].m_s << ", " << inter[i].m_e << ")";
+    }
+    os << "]";
+    return os;
+}
+
+Polynomial::Polynomial(const std::vector<double> &coeffs)
+{
+    int first = 0;
+    while(first < (int)coeffs.size() && fabs(coeffs[first]) < kLeadingCoeffTolerance)
+        ++first;
+    for(int i = first; i < (int)coeffs.size(); ++i)
+        m_coeffs.push_back(coeffs[i]);
+}
+
+double Polynomial::evaluate(double t) const
+{
+    double result = 0;
+    for(int i = 0; i < (int)m_coeffs.size(); ++i)
+        result = result*t + m_coeffs[i];
+    return result;
+}
+
+void PolynomialIntervalSolver::writePolynomials(std::ostream &os)
+{
+    int npolys = s_polynomials.size();
+    os.write((char *)&npolys, sizeof(int));
+    for(int i = 0; i < npolys; ++i)
+    {
+        const std::vector<double> &coeffs = s_polynomials[i].getCoeffs();
+        int ncoeffs = coeffs.size();
+        os.write((char *)&ncoeffs, sizeof(int));
+        for(int j = 0; j < ncoeffs; ++j)
+            os.write((char *)&coeffs[j], sizeof(double));
+    }
+}
+
+void PolynomialIntervalSolver::readPolynomials(std::vector<Polynomial> &polynomials, std::istream &is)
+{
+    polynomials.clear();
+    int npolys;
+    is.read((char *)&npolys, sizeof(int));
+    for(int i = 0; i < npolys; ++i)
+    {
+        std::vector<double> coeffs;
+        int ncoeffs;
+        is.read((char *)&ncoeffs, sizeof(int));
+        for(int j = 0; j < ncoeffs; ++j)
+        {
+            double c;
+            is.read((char *)&c, sizeof(double));
+            coeffs.push_back(c);
+        }
+        polynomials.push_back(Polynomial(coeffs));
+    }
+}
+
+int PolynomialIntervalSolver::findRealRoots(const std::vector<double> &coeffs, double *roots)
+{
+    int degree = (int)coeffs.size() - 1;
+    int nroots = 0;
+
+    if(degree > 3)
+    {
+        double zeror[kMaxDegree], zeroi[kMaxDegree];
+        int found = m_rf.rpoly(&coeffs[0], degree, zeror, zeroi);
+        for(int i = 0; i < found; ++i)
+            if(fabs(zeroi[i]) < kImaginaryTolerance)
+                roots[nroots++] = zeror[i];
+        return nroots;
+    }
+
+    // Zeros at the origin are split off exactly, as rpoly does, which also
+    // leaves the lower-degree cases bit-for-bit identical to it.
+    int n = degree;
+    while(n > 0 && coeffs[n] == 0.0)
+    {
+        roots[nroots++] = 0.0;
+        --n;
+    }
+
+    if(n == 1)
+    {
+        roots[nroots++] = -coeffs[1]/coeffs[0];
+    }
+    else if(n == 2)
+    {
+        nroots += solveQuadratic(&coeffs[0], roots + nroots);
+    }
+    else if(n == 3)
+    {
+        nroots += solveCubic(&coeffs[0], roots + nroots);
+    }
+    return nroots;
+}
+
+void PolynomialIntervalSolver::findPolyIntervals(const Polynomial &poly, Intervals &intervals)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    intervals.clear();
+
+    const std::vector<double> &coeffs = poly.getCoeffs();
+    int degree = (int)coeffs.size() - 1;
+    if(degree < 0)
+        return;
+    assert(degree <= kMaxDegree);
+
+    double roots[kMaxDegree];
+    int nroots = (degree > 0) ? findRealRoots(coeffs, roots) : 0;
+    if(nroots == 0)
+    {
+        if(poly.evaluate(0.0) > 0)
+            intervals.append(Interval(-inf, inf));
+        return;
+    }
+
+    sortRoots(roots, nroots);
+
+    if(poly.evaluate(roots[0] - 1.0) > 0)
+        intervals.append(Interval(-inf, roots[0]));
+    for(int i = 0; i < nroots - 1; ++i)
+        if(poly.evaluate(0.5*(roots[i] + roots[i+1])) > 0)
+            intervals.append(Interval(roots[i], roots[i+1]));
+    if(poly.evaluate(roots[nroots-1] + 1.0) > 0)
+        intervals.append(Interval(roots[nroots-1], inf));
+
+    // Already sorted, but a double root can leave touching neighbours.
+    intervals.sortAndConsolidate();
+}
+
+double PolynomialIntervalSolver::firstIntersectionTime(const std::vector<Polynomial> &polys)
+{
+    if(m_sink != NULL)
+        for(int i = 0; i < (int)polys.size(); ++i)
+            m_sink->record(polys[i]);
+
+    if(polys.empty())
+        return std::numeric_limits<double>::infinity();
+
+    int npolys = (int)polys.size();
+    Intervals inter, polyInter, result;
+    findPolyIntervals(polys[0], inter);
+    for(int i = 1; i < npolys - 1 && !inter.empty(); ++i)
+    {
+        findPolyIntervals(polys[i], polyInter);
+        intersect(inter, polyInter, result);
+        std::swap(inter, result);
+    }
+    if(npolys == 1 || inter.empty())
+        return inter.findNextSatTime(0.0);
+    findPolyIntervals(polys[npolys-1], polyInter);
+    return findNextSatTime(inter, polyInter, 0.0);
+}
+
+double PolynomialIntervalSolver::findFirstIntersectionTime(const std::vector<Polynomial> &polys)
+{
+    PolynomialVectorSink recorder(s_polynomials);
+    PolynomialIntervalSolver solver(&recorder);
+    return solver.firstIntersectionTime(polys);
+}
+
+void PolynomialIntervalSolver::recordPolynomials(const std::vector<Polynomial> &polys)
+{
+    s_polynomials.insert(s_polynomials.end(), polys.begin(), polys.end());
+}
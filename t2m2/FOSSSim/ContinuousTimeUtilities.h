@@ -2,13 +2,14 @@
 #define CONTINUOUS_TIME_UTILITIES_H
 
 #include <vector>
-#include <list>
 #include <cassert>
 #include <iostream>
 #include "rpoly.h"
 
 struct Interval
 {
+    // Leaves the endpoints unset, for Intervals' inline storage.
+    Interval() {}
     Interval(double s, double e): m_s(s), m_e(e) {assert(m_s <= m_e);}
     double m_s, m_e;
     
@@ -19,25 +20,54 @@ bool overlap(const Interval &a, const Interval &b);
 Interval Iunion(const Interval &a, const Interval &b);
 Interval Iintersect(const Interval &a, const Interval &b);
 
+// A sorted list of disjoint intervals. The few spans a CCD query produces
+// live in an inline buffer, so building, intersecting and searching them
+// does not touch the heap; longer lists spill into a vector.
 class Intervals
 {
 public:
+    Intervals(): m_size(0) {}
     Intervals(const std::vector<Interval> &intervals);
+    // Copies only the live part of the inline buffer.
+    Intervals(const Intervals &other);
+    Intervals &operator=(const Intervals &other);
     
-    double findNextSatTime(double t);
+    // Appends an interval in any order. Call sortAndConsolidate() after the
+    // last one to restore the sorted, disjoint form.
+    void append(const Interval &interval);
+    void sortAndConsolidate();
+    void clear() {m_size = 0; m_spill.clear();}
+    
+    int size() const {return m_size;}
+    bool empty() const {return m_size == 0;}
+    const Interval &operator[](int i) const {return data()[i];}
+    
+    double findNextSatTime(double t) const;
     
     friend Intervals intersect(const Intervals &i1, const Intervals &i2);
+    friend void intersect(const Intervals &i1, const Intervals &i2, Intervals &result);
     
     friend std::ostream& operator<<(std::ostream &os, const Intervals &inter);
     
 private:
-    std::list<Interval> m_intervals;
+    static const int kInlineCapacity = 8;
+    
+    const Interval *data() const {return m_spill.empty() ? m_inline : &m_spill[0];}
+    Interval *data() {return m_spill.empty() ? m_inline : &m_spill[0];}
     
     void consolidateIntervals();
     
+    Interval m_inline[kInlineCapacity];
+    std::vector<Interval> m_spill;
+    int m_size;
 };
 
 Intervals intersect(const Intervals &i1, const Intervals &i2);
+// Writes the intersection into result, which must not alias either input.
+void intersect(const Intervals &i1, const Intervals &i2, Intervals &result);
+// The same as intersect(i1, i2).findNextSatTime(t), without building the
+// intersection.
+double findNextSatTime(const Intervals &i1, const Intervals &i2, double t);
 std::ostream &operator<<(std::ostream &os, const Intervals &inter);
 
 class Polynomial
@@ -53,10 +83,53 @@ private:
     std::vector<double> m_coeffs;
 };
 
+// Receives each polynomial a PolynomialIntervalSolver examines, in order.
+class PolynomialSink
+{
+public:
+    virtual ~PolynomialSink() {}
+    
+    virtual void record(const Polynomial &poly) = 0;
+};
+
+// Appends the polynomials to a vector.
+class PolynomialVectorSink : public PolynomialSink
+{
+public:
+    PolynomialVectorSink(std::vector<Polynomial> &polys): m_polys(polys) {}
+    
+    virtual void record(const Polynomial &poly) {m_polys.push_back(poly);}
+    
+private:
+    std::vector<Polynomial> &m_polys;
+};
+
+// A solver owns all of its scratch state, so separate instances can run on
+// separate threads. Polynomials are only recorded when a sink is given; a
+// sink shared between solvers must do its own locking.
 class PolynomialIntervalSolver
 {
 public:
+    PolynomialIntervalSolver(PolynomialSink *sink = NULL): m_sink(sink) {}
+    
+    double firstIntersectionTime(const std::vector<Polynomial> &polys);
+    
+    // Writes the real roots of the polynomial (highest degree coefficient
+    // first) into roots, which must have room for the polynomial's degree,
+    // and returns how many were found. Degrees up to three are solved in
+    // closed form; anything higher goes through the Jenkins-Traub solver.
+    int findRealRoots(const std::vector<double> &coeffs, double *roots);
+    
+    void setSink(PolynomialSink *sink) {m_sink = sink;}
+    
+    // Solves with a temporary solver that records into the global list the
+    // simulation serializes and compares each step. That list is shared, so
+    // this entry point is for the single-threaded handlers only.
     static double findFirstIntersectionTime(const std::vector<Polynomial> &polys);
+    
+    // Appends the polynomials to the global list without solving them, for
+    // queries a conservative filter has already ruled out.
+    static void recordPolynomials(const std::vector<Polynomial> &polys);
 
     static void writePolynomials(std::ostream & os);
     static void readPolynomials(std::vector<Polynomial> & polynomials, std::istream & is);
@@ -66,9 +139,10 @@ public:
     
 private:
     
-    static Intervals findPolyIntervals(const Polynomial &poly);
+    void findPolyIntervals(const Polynomial &poly, Intervals &intervals);
     
-    static RootFinder rf;
+    RootFinder m_rf;
+    PolynomialSink *m_sink;
     
 private:
     static std::vector<Polynomial> s_polynomials;
@@ -33,74 +33,195 @@ ImpactZone mergeZones(const ImpactZone &z1, const ImpactZone &z2)
 }
 
 
-void mergeAllZones(ImpactZones &zones)
+ImpactZoneForest::ImpactZoneForest(int nverts) : m_parent(nverts), m_rank(nverts, 0), m_member(nverts, false), m_halfplane(nverts, false), m_zoneof(nverts, -1)
 {
-    ImpactZones result;
+    for(int i=0; i<nverts; i++)
+        m_parent[i] = i;
+}
+
+void ImpactZoneForest::reset(int nverts)
+{
+    // Only the members can have left their initial state.
+    for(int i=0; i<(int)m_members.size(); i++)
+    {
+        int v = m_members[i];
+        m_parent[v] = v;
+        m_rank[v] = 0;
+        m_member[v] = false;
+        m_halfplane[v] = false;
+    }
+    m_members.clear();
     
-    ImpactZones *src = &zones;
-    ImpactZones *dst = &result;
-    do
+    int oldsize = (int)m_parent.size();
+    if(nverts <= oldsize)
+        return;
+    m_parent.resize(nverts);
+    m_rank.resize(nverts, 0);
+    m_member.resize(nverts, false);
+    m_halfplane.resize(nverts, false);
+    m_zoneof.resize(nverts, -1);
+    for(int i=oldsize; i<nverts; i++)
+        m_parent[i] = i;
+}
+
+int ImpactZoneForest::find(int v)
+{
+    // Path halving: point every other node on the way up at its grandparent.
+    while(m_parent[v] != v)
+    {
+        m_parent[v] = m_parent[m_parent[v]];
+        v = m_parent[v];
+    }
+    return v;
+}
+
+void ImpactZoneForest::addMember(int v)
+{
+    if(m_member[v])
+        return;
+    m_member[v] = true;
+    m_members.push_back(v);
+}
+
+void ImpactZoneForest::unite(int v1, int v2)
+{
+    addMember(v1);
+    addMember(v2);
+    int r1 = find(v1);
+    int r2 = find(v2);
+    if(r1 == r2)
+        return;
+    if(m_rank[r1] < m_rank[r2])
+        std::swap(r1, r2);
+    m_parent[r2] = r1;
+    if(m_rank[r1] == m_rank[r2])
+        m_rank[r1]++;
+    m_halfplane[r1] = m_halfplane[r1] || m_halfplane[r2];
+}
+
+void ImpactZoneForest::addZone(const ImpactZone &zone)
+{
+    if(zone.m_verts.empty())
+        return;
+    int first = *zone.m_verts.begin();
+    for(std::set<int>::const_iterator it = zone.m_verts.begin(); it != zone.m_verts.end(); ++it)
+        unite(first, *it);
+    if(zone.m_halfplane)
+        m_halfplane[find(first)] = true;
+}
+
+void ImpactZoneForest::addCollision(const TwoDScene &scene, const CollisionInfo &collision)
+{
+    switch(collision.m_type)
     {
-        dst->clear();
-        for(int i=0; i<(int)src->size(); i++)
+        case CollisionInfo::PP:
         {
-            bool merged = false;
-            for(int j=0; j<(int)dst->size(); j++)
-            {
-                if(intersects((*dst)[j], (*src)[i]))
-                {
-                    ImpactZone newzone = mergeZones((*dst)[j], (*src)[i]);
-                    (*dst)[j] = newzone;
-                    merged = true;
-                    
-                    break;
-                }
-            }
-            if(!merged)
-            {
-                dst->push_back((*src)[i]);
-            }
+            unite(collision.m_idx1, collision.m_idx2);
+            break;
+        }
+        case CollisionInfo::PE:
+        {
+            unite(collision.m_idx1, scene.getEdge(collision.m_idx2).first);
+            unite(collision.m_idx1, scene.getEdge(collision.m_idx2).second);
+            break;
+        }
+        case CollisionInfo::PH:
+        {
+            addMember(collision.m_idx1);
+            m_halfplane[find(collision.m_idx1)] = true;
+            break;
         }
-        std::swap(src, dst);
     }
-    while(src->size() < dst->size());
-    
-    zones = *dst;
 }
 
-void growImpactZones(const TwoDScene &scene, ImpactZones &zones, const std::vector<CollisionInfo> &impulses)
+void ImpactZoneForest::getZones(FlatImpactZones &zones)
 {
-    for(int i=0; i<(int)impulses.size(); i++)
+    zones.m_verts.clear();
+    zones.m_offsets.assign(1, 0);
+    zones.m_halfplane.clear();
+    
+    // Number the zones in order of their lowest particle and count their
+    // sizes, then lay the particles out zone by zone.
+    std::sort(m_members.begin(), m_members.end());
+    for(int i=0; i<(int)m_members.size(); i++)
     {
-        switch(impulses[i].m_type)
+        int r = find(m_members[i]);
+        if(m_zoneof[r] < 0)
         {
-            case CollisionInfo::PP:
-            {
-                std::set<int> verts;
-                verts.insert(impulses[i].m_idx1);
-                verts.insert(impulses[i].m_idx2);
-                zones.push_back(ImpactZone(verts, false));
-                break;
-            }
-            case CollisionInfo::PE:
-            {
-                std::set<int> verts;
-                verts.insert(impulses[i].m_idx1);
-                verts.insert(scene.getEdge(impulses[i].m_idx2).first);
-                verts.insert(scene.getEdge(impulses[i].m_idx2).second);
-                zones.push_back(ImpactZone(verts, false));
-                break;
-            }
-            case CollisionInfo::PH:
-            {
-                std::set<int> verts;
-                verts.insert(impulses[i].m_idx1);
-                zones.push_back(ImpactZone(verts, true));
-                break;
-            }
+            m_zoneof[r] = zones.size();
+            zones.m_halfplane.push_back(m_halfplane[r]);
+            zones.m_offsets.push_back(0);
         }
+        zones.m_offsets[m_zoneof[r]+1]++;
+    }
+    for(int z=0; z<zones.size(); z++)
+        zones.m_offsets[z+1] += zones.m_offsets[z];
+    
+    std::vector<int> next(zones.m_offsets.begin(), zones.m_offsets.end()-1);
+    zones.m_verts.resize(zones.m_offsets.back());
+    for(int i=0; i<(int)m_members.size(); i++)
+        zones.m_verts[next[m_zoneof[find(m_members[i])]]++] = m_members[i];
+    
+    for(int i=0; i<(int)m_members.size(); i++)
+        m_zoneof[m_members[i]] = -1;
+}
+
+void ImpactZoneForest::getZones(ImpactZones &zones)
+{
+    FlatImpactZones flat;
+    getZones(flat);
+    zones.clear();
+    for(int z=0; z<flat.size(); z++)
+    {
+        std::set<int> verts(flat.m_verts.begin() + flat.m_offsets[z], flat.m_verts.begin() + flat.m_offsets[z+1]);
+        zones.push_back(ImpactZone(verts, flat.m_halfplane[z]));
     }
-    mergeAllZones(zones);
+}
+
+// Zones that share a particle are merged until all zones are disjoint.
+// Zones without particles overlap nothing and are kept as they are.
+void mergeAllZones(ImpactZones &zones)
+{
+    int nverts = 0;
+    for(int i=0; i<(int)zones.size(); i++)
+        if(!zones[i].m_verts.empty())
+            nverts = std::max(nverts, *zones[i].m_verts.rbegin() + 1);
+    
+    ImpactZoneForest forest(nverts);
+    ImpactZones empty;
+    for(int i=0; i<(int)zones.size(); i++)
+    {
+        if(zones[i].m_verts.empty())
+            empty.push_back(zones[i]);
+        else
+            forest.addZone(zones[i]);
+    }
+    
+    forest.getZones(zones);
+    zones.insert(zones.end(), empty.begin(), empty.end());
+}
+
+// Adds one zone per collision and merges, as mergeAllZones would, without
+// building the per-collision zones.
+void growImpactZones(const TwoDScene &scene, ImpactZones &zones, const std::vector<CollisionInfo> &impulses)
+{
+    // Kept between calls, so that a step with a few small zones does not pay
+    // for allocating and initializing a forest over every particle.
+    static ImpactZoneForest forest(0);
+    forest.reset(scene.getNumParticles());
+    ImpactZones empty;
+    for(int i=0; i<(int)zones.size(); i++)
+    {
+        if(zones[i].m_verts.empty())
+            empty.push_back(zones[i]);
+        else
+            forest.addZone(zones[i]);
+    }
+    for(int i=0; i<(int)impulses.size(); i++)
+        forest.addCollision(scene, impulses[i]);
+    
+    forest.getZones(zones);
+    zones.insert(zones.end(), empty.begin(), empty.end());
 }
 
 bool zonesEqual(const ImpactZones &zones1, const ImpactZones &zones2)
@@ -38,6 +38,61 @@ struct ImpactZone
 
 typedef std::vector<ImpactZone> ImpactZones;
 
+// Impact zones as flat index arrays. Zone i holds the particles
+// m_verts[m_offsets[i]] up to m_verts[m_offsets[i+1]-1], in increasing order.
+struct FlatImpactZones
+{
+    std::vector<int> m_verts;
+    std::vector<int> m_offsets;
+    std::vector<bool> m_halfplane;
+
+    int size() const { return (int)m_halfplane.size(); }
+};
+
+// Disjoint-set forest over particle indices. Every set is an impact zone,
+// and its root records whether the zone involves a half-plane. Adding zones
+// and collisions merges overlapping zones as it goes, in near-constant time
+// per particle. The particles added are tracked, so that reading the zones
+// and resetting cost time in their number rather than in nverts.
+class ImpactZoneForest
+{
+public:
+    ImpactZoneForest(int nverts);
+
+    // Empties the forest and makes room for nverts particles
+    void reset(int nverts);
+
+    void addZone(const ImpactZone &zone);
+    void addCollision(const TwoDScene &scene, const CollisionInfo &collision);
+
+    // Zones come out ordered by their lowest particle index.
+    void getZones(FlatImpactZones &zones);
+    void getZones(ImpactZones &zones);
+
+private:
+    int find(int v);
+    void unite(int v1, int v2);
+    void addMember(int v);
+
+    std::vector<int> m_parent;
+    std::vector<int> m_rank;
+    std::vector<bool> m_member;
+    std::vector<bool> m_halfplane;
+    // The particles in some zone, in the order they were added
+    std::vector<int> m_members;
+    // Scratch for getZones, -1 everywhere between calls
+    std::vector<int> m_zoneof;
+};
+
+bool intersects(const ImpactZone &z1, const ImpactZone &z2);
+ImpactZone mergeZones(const ImpactZone &z1, const ImpactZone &z2);
+// Merges zones that share a particle until all zones are disjoint
+void mergeAllZones(ImpactZones &zones);
+// Adds one zone per collision to zones and merges them
+void growImpactZones(const TwoDScene &scene, ImpactZones &zones, const std::vector<CollisionInfo> &impulses);
+// True if both lists hold the same zones, in any order
+bool zonesEqual(const ImpactZones &zones1, const ImpactZones &zones2);
+
 class HybridCollisionHandler : public ContinuousTimeCollisionHandler
 {
 public:
@@ -0,0 +1,290 @@
+#ifndef __FILTER_TEST_H__
+#define __FILTER_TEST_H__
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include "FOSSSim/TwoDScene.h"
+#include "FOSSSim/ContinuousTimeCollisionHandler.h"
+#include "SceneLoader.h"
+
+namespace
+{
+  // Times at which the reference checks sample the motion over a step
+  const int kSamples = 256;
+
+  scalar uniform( scalar lo, scalar hi )
+  {
+    return lo + ( hi - lo )*( std::rand()/(scalar) RAND_MAX );
+  }
+
+  Vector2s lerp( const VectorXs& qs, const VectorXs& qe, int idx, scalar t )
+  {
+    return ( 1.0 - t )*qs.segment<2>( 2*idx ) + t*qe.segment<2>( 2*idx );
+  }
+
+  // True if the particles overlap while approaching at some sampled time
+  bool particleParticleTouch( const TwoDScene& scene, const VectorXs& qs, const VectorXs& qe, int idx1, int idx2 )
+  {
+    const scalar r = scene.getRadius( idx1 ) + scene.getRadius( idx2 );
+    const Vector2s dv = ( qe.segment<2>( 2*idx2 ) - qs.segment<2>( 2*idx2 ) ) - ( qe.segment<2>( 2*idx1 ) - qs.segment<2>( 2*idx1 ) );
+    for( int k = 0; k <= kSamples; ++k )
+    {
+      const scalar t = k/(scalar) kSamples;
+      const Vector2s d = lerp( qs, qe, idx2, t ) - lerp( qs, qe, idx1, t );
+      if( d.norm() <= r && d.dot( dv ) < 0.0 ) return true;
+    }
+    return false;
+  }
+
+  // True if the particle overlaps the edge at some sampled time
+  bool particleEdgeTouch( const TwoDScene& scene, const VectorXs& qs, const VectorXs& qe, int vidx, int eidx )
+  {
+    const scalar r = scene.getRadius( vidx ) + scene.getEdgeRadii()[eidx];
+    for( int k = 0; k <= kSamples; ++k )
+    {
+      const scalar t = k/(scalar) kSamples;
+      const Vector2s x = lerp( qs, qe, vidx, t );
+      const Vector2s a = lerp( qs, qe, scene.getEdge( eidx ).first, t );
+      const Vector2s e = lerp( qs, qe, scene.getEdge( eidx ).second, t ) - a;
+      const scalar len2 = e.squaredNorm();
+      const scalar alpha = len2 > 0.0 ? std::max( 0.0, std::min( 1.0, ( x - a ).dot( e )/len2 ) ) : 0.0;
+      if( ( a + alpha*e - x ).norm() <= r ) return true;
+    }
+    return false;
+  }
+
+  // True if the particle overlaps the half-plane while approaching it at
+  // some sampled time
+  bool particleHalfplaneTouch( const TwoDScene& scene, const VectorXs& qs, const VectorXs& qe, int vidx, int pidx )
+  {
+    const Vector2s xp = scene.getHalfplane( pidx ).first;
+    const Vector2s np = scene.getHalfplane( pidx ).second.normalized();
+    const scalar ds = ( qe.segment<2>( 2*vidx ) - qs.segment<2>( 2*vidx ) ).dot( np );
+    if( ds >= 0.0 ) return false;
+    for( int k = 0; k <= kSamples; ++k )
+    {
+      const scalar t = k/(scalar) kSamples;
+      if( ( lerp( qs, qe, vidx, t ) - xp ).dot( np ) <= scene.getRadius( vidx ) ) return true;
+    }
+    return false;
+  }
+
+  // Runs every detection query of a step through the filters, and checks
+  // that the reference finds no contact during the step for any pair they
+  // reject
+  void checkStep( const TwoDScene& scene, const VectorXs& qs, const VectorXs& qe, long& queries, const std::string& where )
+  {
+    for( int i = 0; i < scene.getNumParticles(); ++i ) for( int j = i + 1; j < scene.getNumParticles(); ++j )
+    {
+      ++queries;
+      if( !ContinuousTimeCollisionHandler::particleParticleSeparated( scene, qs, qe, i, j ) ) continue;
+      EXPECT_FALSE( particleParticleTouch( scene, qs, qe, i, j ) ) << where << ", particles " << i << " " << j;
+    }
+
+    for( int i = 0; i < scene.getNumParticles(); ++i ) for( int e = 0; e < scene.getNumEdges(); ++e )
+    {
+      if( scene.getEdge( e ).first == i || scene.getEdge( e ).second == i ) continue;
+      ++queries;
+      if( !ContinuousTimeCollisionHandler::particleEdgeSeparated( scene, qs, qe, i, e ) ) continue;
+      EXPECT_FALSE( particleEdgeTouch( scene, qs, qe, i, e ) ) << where << ", particle " << i << " edge " << e;
+    }
+
+    for( int i = 0; i < scene.getNumParticles(); ++i ) for( int p = 0; p < scene.getNumHalfplanes(); ++p )
+    {
+      ++queries;
+      if( !ContinuousTimeCollisionHandler::particleHalfplaneSeparated( scene, qs, qe, i, p ) ) continue;
+      EXPECT_FALSE( particleHalfplaneTouch( scene, qs, qe, i, p ) ) << where << ", particle " << i << " halfplane " << p;
+    }
+  }
+
+  void addStats( CCDFilterStats& total, const CCDFilterStats& stats )
+  {
+    total.m_tested += stats.m_tested;
+    total.m_swept_bounds += stats.m_swept_bounds;
+    total.m_relative_velocity += stats.m_relative_velocity;
+    total.m_travel_bound += stats.m_travel_bound;
+    total.m_distance_bound += stats.m_distance_bound;
+  }
+
+  // Sets the start and end positions of a particle
+  void move( VectorXs& qs, VectorXs& qe, int idx, const Vector2s& start, const Vector2s& end )
+  {
+    qs.segment<2>( 2*idx ) = start;
+    qe.segment<2>( 2*idx ) = end;
+  }
+}
+
+// The early-out filters in front of the polynomial solve must never reject a
+// pair that touches during the step. They are called directly, since the
+// handler's vtable lives in the base library next to the simulation's main.
+// Every t2m2 scene is flown ballistically from its initial velocities, with a
+// little jitter so the particles also drift into each other, the edges and
+// the half-planes. Nearly all of those queries are far apart, and the filters
+// should reject at least nine in ten of them.
+TEST(CCDFilters, NeverRejectContacts)
+{
+  const char* const scenes[] =
+  {
+    "t2m2/ContinuousTimeTests/test00.xml",
+    "t2m2/ContinuousTimeTests/test01.xml",
+    "t2m2/ContinuousTimeTests/test02.xml",
+    "t2m2/ContinuousTimeTests/test03.xml",
+    "t2m2/ContinuousTimeTests/test04.xml",
+    "t2m2/ContinuousTimeTests/test05.xml",
+    "t2m2/ContinuousTimeTests/test06.xml",
+    "t2m2/ContinuousTimeTests/test07.xml",
+    "t2m2/ContinuousTimeTests/test08.xml",
+    "t2m2/GeometricTests/test00.xml",
+    "t2m2/GeometricTests/test01.xml",
+    "t2m2/GeometricTests/test02.xml",
+    "t2m2/GeometricTests/test03.xml",
+    "t2m2/GeometricTests/test04.xml",
+    "t2m2/GeometricTests/test05.xml",
+    "t2m2/GeometricTests/test06.xml",
+    "t2m2/GeometricTests/test07.xml",
+    "t2m2/HolisticTests/test00.xml",
+    "t2m2/HolisticTests/test01.xml",
+    "t2m2/HolisticTests/test02.xml",
+    "t2m2/HolisticTests/test03.xml",
+    "t2m2/ImpulsesTests/test00.xml",
+    "t2m2/ImpulsesTests/test01.xml",
+    "t2m2/ImpulsesTests/test02.xml",
+    "t2m2/ImpulsesTests/test03.xml",
+    "t2m2/ImpulsesTests/test04.xml",
+    "t2m2/ImpulsesTests/test05.xml",
+    "t2m2/ImpulsesTests/test06.xml"
+  };
+  const int nsteps = 100;
+
+  CCDFilterStats pp_total;
+  CCDFilterStats pe_total;
+  CCDFilterStats ph_total;
+
+  std::srand( 1 );
+  for( unsigned s = 0; s < sizeof(scenes)/sizeof(scenes[0]); ++s )
+  {
+    TwoDScene scene;
+    scalar dt;
+    ASSERT_TRUE( loadScene( assetPath( scenes[s] ), scene, dt ) ) << scenes[s];
+
+    const int nparticles = scene.getNumParticles();
+    scalar mean_radius = 0.0;
+    for( int i = 0; i < nparticles; ++i ) mean_radius += scene.getRadius(i);
+    mean_radius /= std::max( nparticles, 1 );
+    const scalar jitter = 0.1*mean_radius;
+
+    ContinuousTimeCollisionHandler::resetFilterStats();
+    long queries = 0;
+    VectorXs qs = scene.getX();
+    for( int step = 0; step < nsteps; ++step )
+    {
+      VectorXs qe = qs + dt*scene.getV();
+      for( int i = 0; i < nparticles; ++i )
+      {
+        if( scene.isFixed(i) ) qe.segment<2>( 2*i ) = qs.segment<2>( 2*i );
+        else qe.segment<2>( 2*i ) += Vector2s( uniform( -jitter, jitter ), uniform( -jitter, jitter ) );
+      }
+
+      std::ostringstream where;
+      where << scenes[s] << ", step " << step;
+      checkStep( scene, qs, qe, queries, where.str() );
+      qs = qe;
+    }
+
+    const CCDFilterStats& pp = ContinuousTimeCollisionHandler::getParticleParticleFilterStats();
+    const CCDFilterStats& pe = ContinuousTimeCollisionHandler::getParticleEdgeFilterStats();
+    const CCDFilterStats& ph = ContinuousTimeCollisionHandler::getParticleHalfplaneFilterStats();
+    EXPECT_EQ( queries, pp.m_tested + pe.m_tested + ph.m_tested ) << scenes[s];
+    addStats( pp_total, pp );
+    addStats( pe_total, pe );
+    addStats( ph_total, ph );
+  }
+
+  EXPECT_GE( 10*pp_total.rejected(), 9*pp_total.m_tested );
+  EXPECT_GE( 10*pe_total.rejected(), 9*pe_total.m_tested );
+  EXPECT_GE( 10*ph_total.rejected(), 9*ph_total.m_tested );
+}
+
+// One pair per stage, each placed so that exactly that stage rejects it. The
+// particle sits at the origin; all radii are 0.1.
+TEST(CCDFilters, CountEachStage)
+{
+  TwoDScene scene;
+  scene.resizeSystem( 3 );
+  for( int i = 0; i < 3; ++i ) scene.setRadius( i, 0.1 );
+  scene.insertEdge( std::pair<int,int>( 1, 2 ), 0.1 );
+  VectorXs normal( 2 );
+  normal << 0.0, 1.0;
+  scene.insertHalfplane( std::make_pair( VectorXs( VectorXs::Zero( 2 ) ), normal ) );
+
+  VectorXs qs = VectorXs::Zero( 6 );
+  VectorXs qe = VectorXs::Zero( 6 );
+  ContinuousTimeCollisionHandler::resetFilterStats();
+
+  // Particle-particle: far off along x
+  move( qs, qe, 1, Vector2s( 1.0, 0.0 ), Vector2s( 1.0, 0.0 ) );
+  EXPECT_TRUE( ContinuousTimeCollisionHandler::particleParticleSeparated( scene, qs, qe, 0, 1 ) );
+  // overlapping bounds, but moving apart
+  move( qs, qe, 1, Vector2s( 0.15, 0.0 ), Vector2s( 0.18, 0.0 ) );
+  EXPECT_TRUE( ContinuousTimeCollisionHandler::particleParticleSeparated( scene, qs, qe, 0, 1 ) );
+  // approaching across the corner of the bounds, but never within 0.2
+  move( qs, qe, 1, Vector2s( 0.19, 0.19 ), Vector2s( 0.18, 0.195 ) );
+  EXPECT_TRUE( ContinuousTimeCollisionHandler::particleParticleSeparated( scene, qs, qe, 0, 1 ) );
+  // and head on
+  move( qs, qe, 1, Vector2s( 0.5, 0.0 ), Vector2s( 0.1, 0.0 ) );
+  EXPECT_FALSE( ContinuousTimeCollisionHandler::particleParticleSeparated( scene, qs, qe, 0, 1 ) );
+
+  // Particle-edge: a horizontal edge far above
+  move( qs, qe, 1, Vector2s( -1.0, 1.0 ), Vector2s( -1.0, 1.0 ) );
+  move( qs, qe, 2, Vector2s( 1.0, 1.0 ), Vector2s( 1.0, 1.0 ) );
+  EXPECT_TRUE( ContinuousTimeCollisionHandler::particleEdgeSeparated( scene, qs, qe, 0, 0 ) );
+  // a still edge on the line x + y = -0.5, about 0.35 away, whose bounds
+  // contain the particle
+  move( qs, qe, 1, Vector2s( -1.0, 0.5 ), Vector2s( -1.0, 0.5 ) );
+  move( qs, qe, 2, Vector2s( 0.5, -1.0 ), Vector2s( 0.5, -1.0 ) );
+  EXPECT_TRUE( ContinuousTimeCollisionHandler::particleEdgeSeparated( scene, qs, qe, 0, 0 ) );
+  // the same edge sliding along its line, further than its distance
+  move( qs, qe, 1, Vector2s( -1.0, 0.5 ), Vector2s( -0.5, 0.0 ) );
+  move( qs, qe, 2, Vector2s( 0.5, -1.0 ), Vector2s( 1.0, -1.5 ) );
+  EXPECT_TRUE( ContinuousTimeCollisionHandler::particleEdgeSeparated( scene, qs, qe, 0, 0 ) );
+  // and a horizontal edge sweeping across the particle
+  move( qs, qe, 1, Vector2s( -1.0, 0.5 ), Vector2s( -1.0, -0.5 ) );
+  move( qs, qe, 2, Vector2s( 1.0, 0.5 ), Vector2s( 1.0, -0.5 ) );
+  EXPECT_FALSE( ContinuousTimeCollisionHandler::particleEdgeSeparated( scene, qs, qe, 0, 0 ) );
+
+  // Particle-half-plane: still, well above the plane
+  move( qs, qe, 0, Vector2s( 0.0, 1.0 ), Vector2s( 0.0, 1.0 ) );
+  EXPECT_TRUE( ContinuousTimeCollisionHandler::particleHalfplaneSeparated( scene, qs, qe, 0, 0 ) );
+  // within the radius, but moving away
+  move( qs, qe, 0, Vector2s( 0.0, 0.05 ), Vector2s( 0.0, 0.08 ) );
+  EXPECT_TRUE( ContinuousTimeCollisionHandler::particleHalfplaneSeparated( scene, qs, qe, 0, 0 ) );
+  // and falling through it
+  move( qs, qe, 0, Vector2s( 0.0, 0.5 ), Vector2s( 0.0, -0.1 ) );
+  EXPECT_FALSE( ContinuousTimeCollisionHandler::particleHalfplaneSeparated( scene, qs, qe, 0, 0 ) );
+
+  const CCDFilterStats& pp = ContinuousTimeCollisionHandler::getParticleParticleFilterStats();
+  EXPECT_EQ( 4, pp.m_tested );
+  EXPECT_EQ( 1, pp.m_swept_bounds );
+  EXPECT_EQ( 1, pp.m_relative_velocity );
+  EXPECT_EQ( 0, pp.m_travel_bound );
+  EXPECT_EQ( 1, pp.m_distance_bound );
+
+  const CCDFilterStats& pe = ContinuousTimeCollisionHandler::getParticleEdgeFilterStats();
+  EXPECT_EQ( 4, pe.m_tested );
+  EXPECT_EQ( 1, pe.m_swept_bounds );
+  EXPECT_EQ( 0, pe.m_relative_velocity );
+  EXPECT_EQ( 1, pe.m_travel_bound );
+  EXPECT_EQ( 1, pe.m_distance_bound );
+
+  const CCDFilterStats& ph = ContinuousTimeCollisionHandler::getParticleHalfplaneFilterStats();
+  EXPECT_EQ( 3, ph.m_tested );
+  EXPECT_EQ( 1, ph.m_swept_bounds );
+  EXPECT_EQ( 1, ph.m_relative_velocity );
+  EXPECT_EQ( 0, ph.m_travel_bound );
+  EXPECT_EQ( 0, ph.m_distance_bound );
+}
+
+#endif
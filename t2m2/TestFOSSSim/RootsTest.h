@@ -0,0 +1,288 @@
+#ifndef __ROOTS_TEST_H__
+#define __ROOTS_TEST_H__
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "FOSSSim/ContinuousTimeUtilities.h"
+
+namespace
+{
+  scalar randomIn( scalar lo, scalar hi )
+  {
+    return lo + ( hi - lo )*( std::rand()/(scalar) RAND_MAX );
+  }
+
+  // A coefficient of random sign and magnitude between 1e-6 and 1e6
+  scalar randomCoefficient()
+  {
+    const scalar magnitude = std::pow( 10.0, randomIn( -6.0, 6.0 ) );
+    return std::rand()%2 ? magnitude : -magnitude;
+  }
+
+  Vector2s randomVector( scalar scale )
+  {
+    return Vector2s( randomIn( -scale, scale ), randomIn( -scale, scale ) );
+  }
+
+  scalar cross( const Vector2s& a, const Vector2s& b )
+  {
+    return a.x()*b.y() - a.y()*b.x();
+  }
+
+  // The real roots Jenkins-Traub finds, in increasing order, as every
+  // degree was solved before the closed forms
+  int rpolyRealRoots( const std::vector<double>& coeffs, double* roots )
+  {
+    const int degree = (int) coeffs.size() - 1;
+    double zeror[6], zeroi[6];
+    RootFinder rf;
+    const int found = rf.rpoly( &coeffs[0], degree, zeror, zeroi );
+    int nroots = 0;
+    for( int i = 0; i < found; ++i ) if( std::fabs( zeroi[i] ) < 1e-8 ) roots[nroots++] = zeror[i];
+    std::sort( roots, roots + nroots );
+    return nroots;
+  }
+
+  // PolynomialIntervalSolver::firstIntersectionTime with every root from
+  // Jenkins-Traub
+  double rpolyFirstIntersectionTime( const std::vector<Polynomial>& polys )
+  {
+    const double inf = std::numeric_limits<double>::infinity();
+    if( polys.empty() ) return inf;
+
+    Intervals inter;
+    for( std::vector<Polynomial>::size_type p = 0; p < polys.size(); ++p )
+    {
+      const Polynomial& poly = polys[p];
+      Intervals intervals;
+      double roots[6];
+      const int nroots = poly.getCoeffs().size() > 1 ? rpolyRealRoots( poly.getCoeffs(), roots ) : 0;
+      if( nroots == 0 )
+      {
+        if( !poly.getCoeffs().empty() && poly.evaluate( 0.0 ) > 0 ) intervals.append( Interval( -inf, inf ) );
+      }
+      else
+      {
+        if( poly.evaluate( roots[0] - 1.0 ) > 0 ) intervals.append( Interval( -inf, roots[0] ) );
+        for( int i = 0; i < nroots - 1; ++i )
+          if( poly.evaluate( 0.5*( roots[i] + roots[i+1] ) ) > 0 ) intervals.append( Interval( roots[i], roots[i+1] ) );
+        if( poly.evaluate( roots[nroots-1] + 1.0 ) > 0 ) intervals.append( Interval( roots[nroots-1], inf ) );
+        intervals.sortAndConsolidate();
+      }
+      inter = ( p == 0 ) ? intervals : intersect( inter, intervals );
+    }
+    return inter.findNextSatTime( 0.0 );
+  }
+
+  // Overlap and approach of two particles moving linearly over the step
+  std::vector<Polynomial> particleParticlePolynomials( const Vector2s& dx, const Vector2s& ddx, scalar r )
+  {
+    std::vector<double> position;
+    position.push_back( -ddx.dot( ddx ) );
+    position.push_back( -2.0*dx.dot( ddx ) );
+    position.push_back( r*r - dx.dot( dx ) );
+
+    std::vector<double> velocity;
+    velocity.push_back( -ddx.dot( ddx ) );
+    velocity.push_back( -dx.dot( ddx ) );
+
+    std::vector<Polynomial> polys;
+    polys.push_back( Polynomial( position ) );
+    polys.push_back( Polynomial( velocity ) );
+    return polys;
+  }
+
+  // Overlap and approach of a particle moving linearly towards a half-plane
+  // with unit normal n
+  std::vector<Polynomial> particleHalfplanePolynomials( const Vector2s& x, const Vector2s& dx, const Vector2s& n, scalar r )
+  {
+    std::vector<double> position;
+    position.push_back( -dx.dot( n ) );
+    position.push_back( r - x.dot( n ) );
+
+    std::vector<double> velocity;
+    velocity.push_back( -dx.dot( n ) );
+
+    std::vector<Polynomial> polys;
+    polys.push_back( Polynomial( position ) );
+    polys.push_back( Polynomial( velocity ) );
+    return polys;
+  }
+
+  // Overlap of a particle with an edge, the particle's projection falling
+  // inside the edge, and approach, for linear motion of all three
+  std::vector<Polynomial> particleEdgePolynomials( const Vector2s& x1, const Vector2s& x2, const Vector2s& x3, const Vector2s& dx1, const Vector2s& dx2, const Vector2s& dx3, scalar r )
+  {
+    // Particle relative to the first endpoint, a0 + t a1, and the edge,
+    // e0 + t e1
+    const Vector2s a0 = x1 - x2;
+    const Vector2s a1 = dx1 - dx2;
+    const Vector2s e0 = x3 - x2;
+    const Vector2s e1 = dx3 - dx2;
+
+    // r^2 |e|^2 - (a x e)^2
+    const scalar c0 = cross( a0, e0 );
+    const scalar c1 = cross( a0, e1 ) + cross( a1, e0 );
+    const scalar c2 = cross( a1, e1 );
+    std::vector<double> position;
+    position.push_back( -c2*c2 );
+    position.push_back( -2.0*c1*c2 );
+    position.push_back( r*r*e1.dot( e1 ) - c1*c1 - 2.0*c0*c2 );
+    position.push_back( 2.0*r*r*e0.dot( e1 ) - 2.0*c0*c1 );
+    position.push_back( r*r*e0.dot( e0 ) - c0*c0 );
+
+    // a.e and |e|^2 - a.e
+    std::vector<double> alpha_positive;
+    alpha_positive.push_back( a1.dot( e1 ) );
+    alpha_positive.push_back( a0.dot( e1 ) + a1.dot( e0 ) );
+    alpha_positive.push_back( a0.dot( e0 ) );
+    std::vector<double> alpha_below_one;
+    alpha_below_one.push_back( e1.dot( e1 ) - alpha_positive[0] );
+    alpha_below_one.push_back( 2.0*e0.dot( e1 ) - alpha_positive[1] );
+    alpha_below_one.push_back( e0.dot( e0 ) - alpha_positive[2] );
+
+    // The handler's quintic
+    std::vector<double> velocity;
+    {
+      double a = (x3-x2).dot(x3-x2);
+      double b = (x3-x2).dot(dx3-dx2);
+      double c = (dx3-dx2).dot(dx3-dx2);
+      double d = (dx2-dx1).dot(dx2-dx1);
+      double e = (dx2-dx1).dot(x2-x1);
+      double f = (x1-x2).dot(x3-x2);
+      double g = (x1-x2).dot(dx3-dx2) + (dx1-dx2).dot(x3-x2);
+      double h = (dx1-dx2).dot(dx3-dx2);
+      double i = (dx3-dx2).dot(x2-x1) + (dx2-dx1).dot(x3-x2);
+      double j = (dx3-dx2).dot(dx2-dx1);
+      double k = a*f;
+      double l = a*g+2*b*f;
+      double m = a*h+2*b*g+c*f;
+      double n = c*g+2*b*h;
+      double o = c*h;
+      double p = (dx3-dx2).dot(x3-x2);
+      double q = (dx3-dx2).dot(dx3-dx2);
+
+      velocity.push_back( -h*h*q - c*c*d - 2*o*j );
+      velocity.push_back( -h*h*p - 2*g*h*q - 4*b*c*d - c*c*e - o*i - 2*n*j );
+      velocity.push_back( -2*g*h*p - 2*f*g*q - g*g*q - 2*a*c*d - 4*b*b*d - 4*b*c*e - n*i - 2*m*j );
+      velocity.push_back( -2*f*h*p - g*g*p - 2*f*g*q - 4*a*b*d - 2*a*c*e - 4*b*b*e - m*i - 2*l*j );
+      velocity.push_back( -2*f*g*p - f*f*q - a*a*d - 4*a*b*e - l*i - 2*k*j );
+      velocity.push_back( -f*f*p - a*a*e - k*i );
+    }
+
+    std::vector<Polynomial> polys;
+    polys.push_back( Polynomial( position ) );
+    polys.push_back( Polynomial( alpha_positive ) );
+    polys.push_back( Polynomial( alpha_below_one ) );
+    polys.push_back( Polynomial( velocity ) );
+    return polys;
+  }
+}
+
+// Linear and quadratic polynomials are solved in closed form with the same
+// formulas rpoly reaches for them, so their roots are bit for bit the same.
+// The cases cover random coefficients over twelve orders of magnitude, zeros
+// at the origin, double roots and complex pairs.
+TEST(PolynomialRoots, LowDegreesMatchRpoly)
+{
+  std::srand( 1 );
+  PolynomialIntervalSolver solver;
+  for( int n = 0; n < 20000; ++n )
+  {
+    std::vector<double> coeffs;
+    switch( n%5 )
+    {
+      case 0:
+        coeffs.push_back( randomCoefficient() );
+        coeffs.push_back( randomCoefficient() );
+        break;
+      case 1:
+        coeffs.push_back( randomCoefficient() );
+        coeffs.push_back( randomCoefficient() );
+        coeffs.push_back( randomCoefficient() );
+        break;
+      case 2:
+        coeffs.push_back( randomCoefficient() );
+        coeffs.push_back( randomCoefficient() );
+        coeffs.push_back( 0.0 );
+        break;
+      case 3:
+      {
+        // a (t - s)^2
+        const scalar a = randomCoefficient();
+        const scalar s = randomIn( -2.0, 2.0 );
+        coeffs.push_back( a );
+        coeffs.push_back( -2.0*a*s );
+        coeffs.push_back( a*s*s );
+        break;
+      }
+      case 4:
+      {
+        // a ((t - s)^2 + w^2)
+        const scalar a = randomCoefficient();
+        const scalar s = randomIn( -2.0, 2.0 );
+        const scalar w = std::pow( 10.0, randomIn( -10.0, 0.0 ) );
+        coeffs.push_back( a );
+        coeffs.push_back( -2.0*a*s );
+        coeffs.push_back( a*( s*s + w*w ) );
+        break;
+      }
+    }
+
+    double expected[6];
+    const int nexpected = rpolyRealRoots( coeffs, expected );
+    std::vector<double> roots( 6 );
+    const int nroots = solver.findRealRoots( coeffs, &roots[0] );
+    std::sort( roots.begin(), roots.begin() + nroots );
+
+    ASSERT_EQ( nexpected, nroots ) << "case " << n;
+    for( int i = 0; i < nroots; ++i ) ASSERT_EQ( expected[i], roots[i] ) << "case " << n << ", root " << i;
+  }
+}
+
+// Particle-particle, particle-half-plane and particle-edge queries give the
+// same first contact times, bit for bit, as solving every polynomial with
+// rpoly. Edges that only translate drop the particle-edge polynomials to
+// lower degrees, which takes them through the closed forms too.
+TEST(PolynomialRoots, CCDTimesMatchRpoly)
+{
+  std::srand( 2 );
+  PolynomialIntervalSolver solver;
+  int hits = 0;
+  for( int n = 0; n < 20000; ++n )
+  {
+    std::vector<Polynomial> polys;
+    switch( n%4 )
+    {
+      case 0:
+        polys = particleParticlePolynomials( randomVector( 1.0 ), randomVector( 2.0 ), randomIn( 0.05, 0.5 ) );
+        break;
+      case 1:
+        polys = particleHalfplanePolynomials( randomVector( 1.0 ), randomVector( 2.0 ), randomVector( 1.0 ).normalized(), randomIn( 0.05, 0.5 ) );
+        break;
+      case 2:
+        polys = particleEdgePolynomials( randomVector( 1.0 ), randomVector( 1.0 ), randomVector( 1.0 ), randomVector( 1.0 ), randomVector( 1.0 ), randomVector( 1.0 ), randomIn( 0.05, 0.5 ) );
+        break;
+      case 3:
+      {
+        const Vector2s translation = randomVector( 1.0 );
+        polys = particleEdgePolynomials( randomVector( 1.0 ), randomVector( 1.0 ), randomVector( 1.0 ), randomVector( 1.0 ), translation, translation, randomIn( 0.05, 0.5 ) );
+        break;
+      }
+    }
+
+    const double expected = rpolyFirstIntersectionTime( polys );
+    ASSERT_EQ( expected, solver.firstIntersectionTime( polys ) ) << "query " << n;
+    if( expected <= 1.0 ) ++hits;
+  }
+
+  // Enough of the queries collide within the step to mean something
+  EXPECT_GT( hits, 2000 );
+}
+
+#endif
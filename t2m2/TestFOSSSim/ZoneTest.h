@@ -0,0 +1,120 @@
+#ifndef __ZONE_TEST_H__
+#define __ZONE_TEST_H__
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+#include "FOSSSim/TwoDScene.h"
+#include "FOSSSim/HybridCollisionHandler.h"
+
+namespace
+{
+  // mergeAllZones as it was before the disjoint-set forest: every zone is
+  // merged into the first overlapping merged zone, repeated until a pass
+  // merges nothing
+  void referenceMergeAllZones( ImpactZones& zones )
+  {
+    ImpactZones result;
+    ImpactZones* src = &zones;
+    ImpactZones* dst = &result;
+    do
+    {
+      dst->clear();
+      for( int i = 0; i < (int) src->size(); ++i )
+      {
+        bool merged = false;
+        for( int j = 0; j < (int) dst->size(); ++j )
+        {
+          if( intersects( (*dst)[j], (*src)[i] ) )
+          {
+            (*dst)[j] = mergeZones( (*dst)[j], (*src)[i] );
+            merged = true;
+            break;
+          }
+        }
+        if( !merged ) dst->push_back( (*src)[i] );
+      }
+      std::swap( src, dst );
+    }
+    while( src->size() < dst->size() );
+    zones = *dst;
+  }
+
+  // growImpactZones as it was: one zone per collision, then a merge
+  void referenceGrowImpactZones( const TwoDScene& scene, ImpactZones& zones, const std::vector<CollisionInfo>& impulses )
+  {
+    for( int i = 0; i < (int) impulses.size(); ++i )
+    {
+      std::set<int> verts;
+      verts.insert( impulses[i].m_idx1 );
+      if( impulses[i].m_type == CollisionInfo::PP ) verts.insert( impulses[i].m_idx2 );
+      if( impulses[i].m_type == CollisionInfo::PE )
+      {
+        verts.insert( scene.getEdge( impulses[i].m_idx2 ).first );
+        verts.insert( scene.getEdge( impulses[i].m_idx2 ).second );
+      }
+      zones.push_back( ImpactZone( verts, impulses[i].m_type == CollisionInfo::PH ) );
+    }
+    referenceMergeAllZones( zones );
+  }
+
+  // Up to maxsize random particles below nparticles, empty now and then
+  ImpactZone randomZone( int nparticles, int maxsize )
+  {
+    std::set<int> verts;
+    if( std::rand()%20 != 0 )
+    {
+      const int size = 1 + std::rand()%maxsize;
+      for( int k = 0; k < size; ++k ) verts.insert( std::rand()%nparticles );
+    }
+    return ImpactZone( verts, std::rand()%4 == 0 );
+  }
+
+  CollisionInfo randomCollision( const TwoDScene& scene )
+  {
+    const int nparticles = scene.getNumParticles();
+    const int type = std::rand()%3;
+    if( type == 1 && scene.getNumEdges() > 0 ) return CollisionInfo( CollisionInfo::PE, std::rand()%nparticles, std::rand()%scene.getNumEdges(), Vector2s::Zero(), 0.0 );
+    if( type == 2 ) return CollisionInfo( CollisionInfo::PH, std::rand()%nparticles, 0, Vector2s::Zero(), 0.0 );
+    return CollisionInfo( CollisionInfo::PP, std::rand()%nparticles, std::rand()%nparticles, Vector2s::Zero(), 0.0 );
+  }
+}
+
+// The disjoint-set forest finds exactly the zones the pairwise merge did,
+// for random zones and collisions over scenes of varying size, one after
+// the other
+TEST(ImpactZones, MatchPairwiseMerge)
+{
+  std::srand( 1 );
+  for( int trial = 0; trial < 2000; ++trial )
+  {
+    const int nparticles = 1 + std::rand()%60;
+    TwoDScene scene( nparticles );
+    const int nedges = std::rand()%( nparticles + 1 );
+    for( int e = 0; e < nedges; ++e ) scene.insertEdge( std::make_pair( std::rand()%nparticles, std::rand()%nparticles ), 0.1 );
+
+    ImpactZones zones;
+    const int nzones = std::rand()%10;
+    for( int z = 0; z < nzones; ++z ) zones.push_back( randomZone( nparticles, 4 ) );
+
+    ImpactZones merged = zones;
+    mergeAllZones( merged );
+    ImpactZones expected = zones;
+    referenceMergeAllZones( expected );
+    ASSERT_TRUE( zonesEqual( expected, merged ) ) << "trial " << trial;
+
+    std::vector<CollisionInfo> impulses;
+    const int ncollisions = std::rand()%( 2*nparticles );
+    for( int c = 0; c < ncollisions; ++c ) impulses.push_back( randomCollision( scene ) );
+
+    ImpactZones grown = merged;
+    growImpactZones( scene, grown, impulses );
+    ImpactZones expected_grown = expected;
+    referenceGrowImpactZones( scene, expected_grown, impulses );
+    ASSERT_TRUE( zonesEqual( expected_grown, grown ) ) << "trial " << trial;
+  }
+}
+
+#endif
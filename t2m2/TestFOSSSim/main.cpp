@@ -0,0 +1,13 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "FilterTest.h"
+#include "RootsTest.h"
+#include "ZoneTest.h"
+
+
+int main( int argc, char **argv ) 
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,19 @@
+#include "BatchDetectionCallback.h"
+
+BatchDetectionCallback::~BatchDetectionCallback()
+{}
+
+void BatchDetectionCallback::ParticleParticleBatch(const int *idx1, const int *idx2, int count)
+{
+  for( int i = 0; i < count; ++i ) ParticleParticleCallback(idx1[i], idx2[i]);
+}
+
+void BatchDetectionCallback::ParticleEdgeBatch(const int *vidx, const int *eidx, int count)
+{
+  for( int i = 0; i < count; ++i ) ParticleEdgeCallback(vidx[i], eidx[i]);
+}
+
+void BatchDetectionCallback::ParticleHalfplaneBatch(const int *vidx, const int *hidx, int count)
+{
+  for( int i = 0; i < count; ++i ) ParticleHalfplaneCallback(vidx[i], hidx[i]);
+}
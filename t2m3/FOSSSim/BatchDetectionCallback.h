@@ -0,0 +1,29 @@
+#ifndef BATCH_DETECTION_CALLBACK_H
+#define BATCH_DETECTION_CALLBACK_H
+
+#include "CollisionDetector.h"
+
+// A DetectionCallback that can take candidate pairs in batches. Detectors that
+// support it (they check with dynamic_cast, since DetectionCallback is shared
+// with prebuilt handlers and cannot gain new virtuals) hand over each category
+// as contiguous index arrays, one virtual call per batch instead of per pair,
+// so the handler can run its narrow phase over a whole batch at once. The
+// default implementations forward every pair to the single pair callbacks.
+//
+// All batches of a detection pass are computed before the first is delivered:
+// a handler that moves particles while handling them is not sent the new pairs
+// this creates, unlike with the single pair callbacks.
+class BatchDetectionCallback : public DetectionCallback
+{
+ public:
+  virtual ~BatchDetectionCallback();
+
+  virtual void ParticleParticleBatch(const int *idx1, const int *idx2, int count);
+
+  // Pairs where the particle is an endpoint of the edge are never included
+  virtual void ParticleEdgeBatch(const int *vidx, const int *eidx, int count);
+
+  virtual void ParticleHalfplaneBatch(const int *vidx, const int *hidx, int count);
+};
+
+#endif
@@ -5,6 +5,11 @@
 
 class TwoDScene;
 
+// Detectors pad particle boxes and halfplane distances by this much.
+// Continuous time detection decides contact from polynomial roots, so pairs
+// that only touch up to round off can still collide and must not be culled.
+const scalar kContactTolerance = 1e-8;
+
 class DetectionCallback
 {
  public:
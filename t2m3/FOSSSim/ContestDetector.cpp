@@ -1,7 +1,691 @@
 #include "ContestDetector.h"
 #include <iostream>
 #include "TwoDScene.h"
-#include <set>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <mutex>
+#include "SpatialGrid.h"
+#include "EdgeBVH.h"
+#include "BatchDetectionCallback.h"
+
+namespace
+{
+  // Moved particles are checked against each other directly; past this many
+  // the broad phase structures are refitted instead
+  const int kMaxMovedParticles = 64;
+
+  // Pairs handed to a BatchDetectionCallback per call
+  const int kBatchSize = 256;
+
+  // The broad phase queries are split into at most this many chunks, each
+  // with at least kMinChunkParticles particles, that run in parallel. Each
+  // chunk writes to its own lists, which are concatenated and sorted
+  // afterwards, so the pairs and their order do not depend on the number of
+  // threads.
+  const int kMaxChunks = 64;
+  const int kMinChunkParticles = 512;
+
+  // Skin of the neighbour lists, as a fraction of the mean particle radius
+  const scalar kSkinRadiusFraction = 0.5;
+
+  // Walks a sorted pair list while pairs are still being added. Added pairs
+  // wait in a min-heap and are merged into the walk; those that sort before
+  // the current position are dropped, so every pair is visited at most once
+  // and in order.
+  class PairWalk
+  {
+  public:
+    explicit PairWalk(const PairList &pairs)
+    : m_pairs(pairs)
+    , m_next(0)
+    , m_started(false)
+    , m_last(0)
+    {}
+
+    void reset()
+    {
+      m_next = 0;
+      m_started = false;
+      m_pending.clear();
+    }
+
+    void insert(int first, int second)
+    {
+      PairList::Key key = PairList::pack(first, second);
+      if( m_started && key <= m_last ) return;
+      m_pending.push_back(key);
+      std::push_heap(m_pending.begin(), m_pending.end(), std::greater<PairList::Key>());
+    }
+
+    bool next(int &first, int &second)
+    {
+      while( true )
+      {
+        PairList::Key key;
+        if( m_next < m_pairs.size() && (m_pending.empty() || m_pairs[m_next] <= m_pending.front()) )
+        {
+          key = m_pairs[m_next++];
+        }
+        else if( !m_pending.empty() )
+        {
+          std::pop_heap(m_pending.begin(), m_pending.end(), std::greater<PairList::Key>());
+          key = m_pending.back();
+          m_pending.pop_back();
+        }
+        else
+        {
+          return false;
+        }
+
+        if( m_started && key <= m_last ) continue;
+        m_started = true;
+        m_last = key;
+        first = PairList::first(key);
+        second = PairList::second(key);
+        return true;
+      }
+    }
+
+  private:
+    const PairList &m_pairs;
+    std::vector<PairList::Key>::size_type m_next;
+    bool m_started;
+    PairList::Key m_last;
+    std::vector<PairList::Key> m_pending;
+  };
+
+  // Box bounding particle i, padded, over its motion from qs to qe
+  void sweptParticleBox(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int i, Vector2s &min, Vector2s &max, scalar padding = 0.0)
+  {
+    scalar r = scene.getRadius(i) + kContactTolerance + padding;
+    min = qs.segment<2>(2*i).cwiseMin(qe.segment<2>(2*i)) - Vector2s(r, r);
+    max = qs.segment<2>(2*i).cwiseMax(qe.segment<2>(2*i)) + Vector2s(r, r);
+  }
+
+  // Box bounding edge e over its motion from qs to qe
+  void sweptEdgeBox(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int e, Vector2s &min, Vector2s &max)
+  {
+    const std::pair<int,int> &edge = scene.getEdge(e);
+    scalar r = scene.getEdgeRadii()[e];
+    min = qs.segment<2>(2*edge.first).cwiseMin(qe.segment<2>(2*edge.first)).cwiseMin(qs.segment<2>(2*edge.second)).cwiseMin(qe.segment<2>(2*edge.second)) - Vector2s(r, r);
+    max = qs.segment<2>(2*edge.first).cwiseMax(qe.segment<2>(2*edge.first)).cwiseMax(qs.segment<2>(2*edge.second)).cwiseMax(qe.segment<2>(2*edge.second)) + Vector2s(r, r);
+  }
+
+  bool boxesOverlap(const Vector2s &amin, const Vector2s &amax, const Vector2s &bmin, const Vector2s &bmax)
+  {
+    return amin.x() <= bmax.x() && bmin.x() <= amax.x() && amin.y() <= bmax.y() && bmin.y() <= amax.y();
+  }
+
+  // The signed distance to a halfplane is linear along the motion, so
+  // checking both ends of it is enough. Like the boxes, padding bounds how far
+  // each coordinate may move; moving that far in x and y changes the distance
+  // along the unit normal n by up to padding*(|nx| + |ny|).
+  bool nearHalfplane(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, int i, int h, scalar padding = 0.0)
+  {
+    const std::pair<VectorXs, VectorXs> &halfplane = scene.getHalfplane(h);
+    Vector2s n = halfplane.second.segment<2>(0).normalized();
+    scalar ds = (qs.segment<2>(2*i) - halfplane.first.segment<2>(0)).dot(n);
+    scalar de = (qe.segment<2>(2*i) - halfplane.first.segment<2>(0)).dot(n);
+    return std::min(ds, de) <= scene.getRadius(i) + kContactTolerance + padding*n.lpNorm<1>();
+  }
+
+  struct DetectorState;
+
+  // Collision handlers respond inside the callbacks and may move qe while the
+  // pairs are being reported. The tracker notices particles whose end
+  // position changed and adds the pairs their new motion creates. Pairs that
+  // sort before the one being reported are not revisited, just as an all
+  // pairs detector would not revisit them.
+  //
+  // The grid and edge tree still hold the boxes from before the callbacks,
+  // which still contain the boxes of objects that have not moved; moved particles and
+  // their edges are checked directly until there are too many of them, at
+  // which point the grid and tree are refitted to the current qe.
+  class MovedParticleTracker
+  {
+  public:
+    MovedParticleTracker()
+    : m_state(NULL)
+    , m_scene(NULL)
+    , m_qs(NULL)
+    , m_qe(NULL)
+    {}
+
+    void reset(DetectorState &state, const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe)
+    {
+      m_state = &state;
+      m_scene = &scene;
+      m_qs = &qs;
+      m_qe = &qe;
+      m_seen = qe;
+      m_particle_moved.clear();
+      m_edge_moved.clear();
+      m_moved_particles.clear();
+      m_moved_edges.clear();
+    }
+
+    void update(const int *particles, int count)
+    {
+      for( int k = 0; k < count; ++k )
+      {
+        const int p = particles[k];
+        if( m_qe->segment<2>(2*p) == m_seen.segment<2>(2*p) ) continue;
+        m_seen.segment<2>(2*p) = m_qe->segment<2>(2*p);
+        addPairs(p);
+      }
+    }
+
+  private:
+    void addPairs(int p);
+
+    // Particle to edge incidence, only built once something has moved
+    void initialize()
+    {
+      const int nparticles = m_scene->getNumParticles();
+      const int nedges = m_scene->getNumEdges();
+      m_particle_moved.assign(nparticles, 0);
+      m_edge_moved.assign(nedges, 0);
+
+      m_incident_start.assign(nparticles + 1, 0);
+      for( int e = 0; e < nedges; ++e )
+      {
+        ++m_incident_start[m_scene->getEdge(e).first + 1];
+        ++m_incident_start[m_scene->getEdge(e).second + 1];
+      }
+      for( int i = 0; i < nparticles; ++i ) m_incident_start[i+1] += m_incident_start[i];
+      m_incident.resize(2*nedges);
+      m_next.assign(m_incident_start.begin(), m_incident_start.end() - 1);
+      for( int e = 0; e < nedges; ++e )
+      {
+        m_incident[m_next[m_scene->getEdge(e).first]++] = e;
+        m_incident[m_next[m_scene->getEdge(e).second]++] = e;
+      }
+    }
+
+    void refit();
+    void addParticlePair(int p, const Vector2s &pmin, const Vector2s &pmax, int j);
+    void addParticleEdgePair(int p, const Vector2s &pmin, const Vector2s &pmax, int e);
+    void addEdgeParticlePair(int e, const Vector2s &emin, const Vector2s &emax, int j);
+
+    DetectorState *m_state;
+    const TwoDScene *m_scene;
+    const VectorXs *m_qs;
+    const VectorXs *m_qe;
+    VectorXs m_seen;
+
+    std::vector<char> m_particle_moved;
+    std::vector<char> m_edge_moved;
+    std::vector<int> m_moved_particles;
+    std::vector<int> m_moved_edges;
+
+    std::vector<int> m_incident_start;
+    std::vector<int> m_incident;
+    std::vector<int> m_next;
+
+    std::vector<int> m_candidates;
+  };
+
+  // Everything a detector keeps between calls. The prebuilt library fixes
+  // ContestDetector's layout, so this lives in a map keyed on the detector
+  // rather than in its members.
+  struct DetectorState
+  {
+    DetectorState()
+    : m_ppwalk(m_pppairs)
+    , m_pewalk(m_pepairs)
+    , m_phwalk(m_phpairs)
+    , m_near_nedges(-1)
+    , m_near_nhalfplanes(-1)
+    , m_half_skin(0.0)
+    , m_near_valid(false)
+    , m_num_near_builds(0)
+    , m_num_incident(0)
+    , m_busy(false)
+    {}
+
+    // Kept between calls so the grid's buffers are reused and the edge tree is
+    // only refitted every step
+    SpatialGrid m_grid;
+    EdgeBVH m_bvh;
+
+    // Pair buffers and their walks, kept so their capacity is reused
+    PPList m_pppairs;
+    PEList m_pepairs;
+    PHList m_phpairs;
+    PairWalk m_ppwalk;
+    PairWalk m_pewalk;
+    PairWalk m_phwalk;
+
+    // Scratch space for the broad phase
+    std::vector<Vector2s> m_pmin;
+    std::vector<Vector2s> m_pmax;
+    PairList m_chunk_pppairs[kMaxChunks];
+    PairList m_chunk_pepairs[kMaxChunks];
+    PairList m_chunk_phpairs[kMaxChunks];
+    std::vector<int> m_chunk_edges[kMaxChunks];
+    int m_chunk_incident[kMaxChunks];
+    std::vector<Vector2s> m_emin;
+    std::vector<Vector2s> m_emax;
+
+    // Verlet style neighbour lists. The pair lists are built from boxes padded
+    // by half the skin, and reused while no particle is more than half the skin
+    // away from where it was at the build: until then every pair of current
+    // boxes that overlap is in the lists. Each call filters them against the
+    // current boxes, which yields exactly the pairs a fresh build would, so
+    // repeated calls on nearly the same positions (implicit integrators
+    // evaluating penalty forces several times a step) skip the broad phase.
+    PairList m_near_pppairs;
+    PairList m_near_pepairs;
+    PairList m_near_phpairs;
+    VectorXs m_near_qs;
+    VectorXs m_near_qe;
+    int m_near_nedges;
+    int m_near_nhalfplanes;
+    scalar m_half_skin;
+    bool m_near_valid;
+    int m_num_near_builds;
+
+    // Endpoints of edge e at 2*e and 2*e+1, copied from the scene at the start
+    // of every pass so the filter below reads one flat array
+    std::vector<int> m_edge_ends;
+
+    // Particle-edge pairs dropped because the particle is one of the edge's
+    // endpoints, during the last call
+    int m_num_incident;
+
+    MovedParticleTracker m_tracker;
+
+    int m_batch1[kBatchSize];
+    int m_batch2[kBatchSize];
+
+    // Set while the pairs are being reported
+    bool m_busy;
+
+  private:
+    // The walks refer to the pair lists, so the state cannot be copied
+    DetectorState(const DetectorState &);
+    DetectorState &operator=(const DetectorState &);
+  };
+
+  // The state of every live detector
+  std::map<const ContestDetector*, DetectorState*> g_states;
+  std::mutex g_states_mutex;
+
+  DetectorState &stateOf(const ContestDetector *detector)
+  {
+    std::lock_guard<std::mutex> lock(g_states_mutex);
+    DetectorState *&state = g_states[detector];
+    if( state == NULL ) state = new DetectorState;
+    return *state;
+  }
+
+  // A particle never collides with an edge it is an endpoint of. In ribbons
+  // and other chains of edges such pairs make up most of the candidates, so
+  // they are rejected as soon as they are found.
+  bool isIncident(const DetectorState &state, int p, int e)
+  {
+    return state.m_edge_ends[2*e] == p || state.m_edge_ends[2*e+1] == p;
+  }
+
+  // Fits the grid and edge tree to the motion from qs to qe, with all boxes
+  // grown by padding. The particle boxes are left in m_pmin and m_pmax.
+  void fitBroadPhase(DetectorState &state, const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, scalar padding = 0.0)
+  {
+    const int nparticles = scene.getNumParticles();
+    state.m_pmin.resize(nparticles);
+    state.m_pmax.resize(nparticles);
+    for( int i = 0; i < nparticles; ++i ) sweptParticleBox(scene, qs, qe, i, state.m_pmin[i], state.m_pmax[i], padding);
+
+    state.m_grid.reset(state.m_pmin, state.m_pmax, scene.getRadii());
+    state.m_bvh.update(scene, qs, qe, padding);
+  }
+
+  void MovedParticleTracker::addPairs(int p)
+  {
+    if( m_particle_moved.empty() ) initialize();
+
+    if( (int) m_moved_particles.size() >= kMaxMovedParticles ) refit();
+
+    if( !m_particle_moved[p] )
+    {
+      m_particle_moved[p] = 1;
+      m_moved_particles.push_back(p);
+    }
+
+    Vector2s pmin, pmax;
+    sweptParticleBox(*m_scene, *m_qs, *m_qe, p, pmin, pmax);
+
+    m_candidates.clear();
+    m_state->m_grid.queryBox(pmin, pmax, m_candidates);
+    for( std::vector<int>::size_type k = 0; k < m_candidates.size(); ++k )
+      if( !m_particle_moved[m_candidates[k]] ) addParticlePair(p, pmin, pmax, m_candidates[k]);
+    for( std::vector<int>::size_type k = 0; k < m_moved_particles.size(); ++k )
+      addParticlePair(p, pmin, pmax, m_moved_particles[k]);
+
+    m_candidates.clear();
+    m_state->m_bvh.queryBox(pmin, pmax, m_candidates);
+    for( std::vector<int>::size_type k = 0; k < m_candidates.size(); ++k )
+      if( !m_edge_moved[m_candidates[k]] ) addParticleEdgePair(p, pmin, pmax, m_candidates[k]);
+    for( std::vector<int>::size_type k = 0; k < m_moved_edges.size(); ++k )
+      addParticleEdgePair(p, pmin, pmax, m_moved_edges[k]);
+
+    for( int k = m_incident_start[p]; k < m_incident_start[p+1]; ++k )
+    {
+      const int e = m_incident[k];
+      if( !m_edge_moved[e] )
+      {
+        m_edge_moved[e] = 1;
+        m_moved_edges.push_back(e);
+      }
+
+      Vector2s emin, emax;
+      sweptEdgeBox(*m_scene, *m_qs, *m_qe, e, emin, emax);
+      m_candidates.clear();
+      m_state->m_grid.queryBox(emin, emax, m_candidates);
+      for( std::vector<int>::size_type j = 0; j < m_candidates.size(); ++j )
+        if( !m_particle_moved[m_candidates[j]] ) addEdgeParticlePair(e, emin, emax, m_candidates[j]);
+      for( std::vector<int>::size_type j = 0; j < m_moved_particles.size(); ++j )
+        addEdgeParticlePair(e, emin, emax, m_moved_particles[j]);
+    }
+
+    for( int h = 0; h < m_scene->getNumHalfplanes(); ++h )
+      if( nearHalfplane(*m_scene, *m_qs, *m_qe, p, h) ) m_state->m_phwalk.insert(p, h);
+  }
+
+  void MovedParticleTracker::refit()
+  {
+    // The unpadded refit no longer covers the neighbour lists' skin
+    m_state->m_near_valid = false;
+    fitBroadPhase(*m_state, *m_scene, *m_qs, *m_qe);
+    for( std::vector<int>::size_type k = 0; k < m_moved_particles.size(); ++k ) m_particle_moved[m_moved_particles[k]] = 0;
+    for( std::vector<int>::size_type k = 0; k < m_moved_edges.size(); ++k ) m_edge_moved[m_moved_edges[k]] = 0;
+    m_moved_particles.clear();
+    m_moved_edges.clear();
+  }
+
+  void MovedParticleTracker::addParticlePair(int p, const Vector2s &pmin, const Vector2s &pmax, int j)
+  {
+    if( j == p ) return;
+    Vector2s jmin, jmax;
+    sweptParticleBox(*m_scene, *m_qs, *m_qe, j, jmin, jmax);
+    if( boxesOverlap(pmin, pmax, jmin, jmax) ) m_state->m_ppwalk.insert(std::min(p, j), std::max(p, j));
+  }
+
+  void MovedParticleTracker::addParticleEdgePair(int p, const Vector2s &pmin, const Vector2s &pmax, int e)
+  {
+    if( isIncident(*m_state, p, e) ) { ++m_state->m_num_incident; return; }
+    Vector2s emin, emax;
+    sweptEdgeBox(*m_scene, *m_qs, *m_qe, e, emin, emax);
+    if( boxesOverlap(pmin, pmax, emin, emax) ) m_state->m_pewalk.insert(p, e);
+  }
+
+  void MovedParticleTracker::addEdgeParticlePair(int e, const Vector2s &emin, const Vector2s &emax, int j)
+  {
+    if( isIncident(*m_state, j, e) ) { ++m_state->m_num_incident; return; }
+    Vector2s jmin, jmax;
+    sweptParticleBox(*m_scene, *m_qs, *m_qe, j, jmin, jmax);
+    if( boxesOverlap(jmin, jmax, emin, emax) ) m_state->m_pewalk.insert(j, e);
+  }
+}
+
+// Reports candidate pairs for the motion from qs to qe. When the positions
+// are equal the candidates are the pairs overlapping at that instant, which
+// is what the penalty method needs. Otherwise the candidates are the pairs
+// whose swept volumes overlap, so continuous time collision handling can cull
+// pairs without missing collisions part way through the step.
+namespace
+{
+  // Whether the neighbour lists still cover every pair for the motion from
+  // qs to qe
+  bool neighbourListsValid(const DetectorState &state, const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe)
+  {
+    if( !state.m_near_valid || qs.size() != state.m_near_qs.size() ) return false;
+    if( scene.getNumEdges() != state.m_near_nedges || scene.getNumHalfplanes() != state.m_near_nhalfplanes ) return false;
+    for( VectorXs::Index k = 0; k < qs.size(); ++k )
+      if( std::fabs(qs(k) - state.m_near_qs(k)) > state.m_half_skin || std::fabs(qe(k) - state.m_near_qe(k)) > state.m_half_skin ) return false;
+    return true;
+  }
+
+  // Builds the neighbour lists, in parallel chunks that each fill their own
+  // lists
+  void buildNeighbourLists(DetectorState &state, const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe)
+  {
+    const int nparticles = scene.getNumParticles();
+
+    scalar mean_radius = 0.0;
+    for( int i = 0; i < nparticles; ++i ) mean_radius += scene.getRadius(i);
+    if( nparticles > 0 ) mean_radius /= nparticles;
+    state.m_half_skin = 0.5*kSkinRadiusFraction*mean_radius;
+
+    // The boxes get kContactTolerance on top of the half skin, so round off
+    // in the box bounds cannot lose a pair that moved exactly half the skin
+    const scalar padding = state.m_half_skin + kContactTolerance;
+    fitBroadPhase( state, scene, qs, qe, padding );
+
+    const int nchunks = std::max( 1, std::min( kMaxChunks, nparticles/kMinChunkParticles ) );
+
+    #pragma omp parallel for schedule(dynamic)
+    for( int c = 0; c < nchunks; ++c )
+    {
+      state.m_chunk_pppairs[c].clear();
+      state.m_chunk_pepairs[c].clear();
+      state.m_chunk_phpairs[c].clear();
+      state.m_chunk_incident[c] = 0;
+
+      state.m_grid.findParticleParticlePairs( state.m_chunk_pppairs[c], c, nchunks );
+
+      const int begin = (int) ( (long long) nparticles*c/nchunks );
+      const int end = (int) ( (long long) nparticles*(c+1)/nchunks );
+      std::vector<int> &edges = state.m_chunk_edges[c];
+      for( int i = begin; i < end; ++i )
+      {
+        edges.clear();
+        state.m_bvh.queryBox( state.m_pmin[i], state.m_pmax[i], edges );
+        for( std::vector<int>::size_type k = 0; k < edges.size(); ++k )
+        {
+          if( isIncident( state, i, edges[k] ) ) ++state.m_chunk_incident[c];
+          else state.m_chunk_pepairs[c].insert( i, edges[k] );
+        }
+
+        // There are only ever a handful of halfplanes, so test them directly
+        for( int h = 0; h < scene.getNumHalfplanes(); ++h )
+          if( nearHalfplane( scene, qs, qe, i, h, padding ) ) state.m_chunk_phpairs[c].insert( i, h );
+      }
+    }
+
+    state.m_near_pppairs.clear();
+    state.m_near_pepairs.clear();
+    state.m_near_phpairs.clear();
+    state.m_num_incident = 0;
+    for( int c = 0; c < nchunks; ++c )
+    {
+      state.m_num_incident += state.m_chunk_incident[c];
+      state.m_near_pppairs.append( state.m_chunk_pppairs[c] );
+      state.m_near_pepairs.append( state.m_chunk_pepairs[c] );
+      state.m_near_phpairs.append( state.m_chunk_phpairs[c] );
+    }
+    state.m_near_pppairs.sortAndRemoveDuplicates();
+    state.m_near_pepairs.sortAndRemoveDuplicates();
+    state.m_near_phpairs.sortAndRemoveDuplicates();
+
+    state.m_near_qs = qs;
+    state.m_near_qe = qe;
+    state.m_near_nedges = scene.getNumEdges();
+    state.m_near_nhalfplanes = scene.getNumHalfplanes();
+    state.m_near_valid = true;
+    ++state.m_num_near_builds;
+  }
+
+  // Each object is bounded by the box spanning its start and end positions,
+  // inflated by its radius, which contains everything it touches during the
+  // step. The candidates come from the neighbour lists, rebuilt only when
+  // needed.
+  void findCandidatePairs(DetectorState &state, const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, PPList &pppairs, PEList &pepairs, PHList &phpairs)
+  {
+    const int nparticles = scene.getNumParticles();
+    const int nedges = scene.getNumEdges();
+
+    pppairs.clear();
+    pepairs.clear();
+    phpairs.clear();
+
+    state.m_edge_ends.resize( 2*nedges );
+    for( int e = 0; e < nedges; ++e )
+    {
+      state.m_edge_ends[2*e] = scene.getEdge(e).first;
+      state.m_edge_ends[2*e+1] = scene.getEdge(e).second;
+    }
+
+    if( !neighbourListsValid( state, scene, qs, qe ) ) buildNeighbourLists( state, scene, qs, qe );
+
+    std::vector<Vector2s> &pmin = state.m_pmin;
+    std::vector<Vector2s> &pmax = state.m_pmax;
+    std::vector<Vector2s> &emin = state.m_emin;
+    std::vector<Vector2s> &emax = state.m_emax;
+    pmin.resize( nparticles );
+    pmax.resize( nparticles );
+    for( int i = 0; i < nparticles; ++i ) sweptParticleBox( scene, qs, qe, i, pmin[i], pmax[i] );
+    emin.resize( nedges );
+    emax.resize( nedges );
+    for( int e = 0; e < nedges; ++e ) sweptEdgeBox( scene, qs, qe, e, emin[e], emax[e] );
+
+    // Filtering keeps the lists sorted
+    for( std::vector<PairList::Key>::size_type k = 0; k < state.m_near_pppairs.size(); ++k )
+    {
+      const int i = PairList::first( state.m_near_pppairs[k] );
+      const int j = PairList::second( state.m_near_pppairs[k] );
+      if( boxesOverlap( pmin[i], pmax[i], pmin[j], pmax[j] ) ) pppairs.insert( i, j );
+    }
+    for( std::vector<PairList::Key>::size_type k = 0; k < state.m_near_pepairs.size(); ++k )
+    {
+      const int i = PairList::first( state.m_near_pepairs[k] );
+      const int e = PairList::second( state.m_near_pepairs[k] );
+      if( boxesOverlap( pmin[i], pmax[i], emin[e], emax[e] ) ) pepairs.insert( i, e );
+    }
+    for( std::vector<PairList::Key>::size_type k = 0; k < state.m_near_phpairs.size(); ++k )
+    {
+      const int i = PairList::first( state.m_near_phpairs[k] );
+      const int h = PairList::second( state.m_near_phpairs[k] );
+      if( nearHalfplane( scene, qs, qe, i, h ) ) phpairs.insert( i, h );
+    }
+  }
+}
+
+namespace
+{
+  // Delivers every pair of the three lists to a batching callback, in order,
+  // in chunks of at most kBatchSize
+  void deliverBatches(DetectorState &state, BatchDetectionCallback &dc)
+  {
+    int *batch1 = state.m_batch1;
+    int *batch2 = state.m_batch2;
+
+    int count = 0;
+    for( std::vector<PairList::Key>::size_type i = 0; i < state.m_pppairs.size(); ++i )
+    {
+      batch1[count] = PairList::first(state.m_pppairs[i]);
+      batch2[count] = PairList::second(state.m_pppairs[i]);
+      if( ++count == kBatchSize )
+      {
+        dc.ParticleParticleBatch(batch1, batch2, count);
+        count = 0;
+      }
+    }
+    if( count > 0 ) dc.ParticleParticleBatch(batch1, batch2, count);
+
+    count = 0;
+    for( std::vector<PairList::Key>::size_type i = 0; i < state.m_pepairs.size(); ++i )
+    {
+      batch1[count] = PairList::first(state.m_pepairs[i]);
+      batch2[count] = PairList::second(state.m_pepairs[i]);
+      if( ++count == kBatchSize )
+      {
+        dc.ParticleEdgeBatch(batch1, batch2, count);
+        count = 0;
+      }
+    }
+    if( count > 0 ) dc.ParticleEdgeBatch(batch1, batch2, count);
+
+    count = 0;
+    for( std::vector<PairList::Key>::size_type i = 0; i < state.m_phpairs.size(); ++i )
+    {
+      batch1[count] = PairList::first(state.m_phpairs[i]);
+      batch2[count] = PairList::second(state.m_phpairs[i]);
+      if( ++count == kBatchSize )
+      {
+        dc.ParticleHalfplaneBatch(batch1, batch2, count);
+        count = 0;
+      }
+    }
+    if( count > 0 ) dc.ParticleHalfplaneBatch(batch1, batch2, count);
+  }
+
+  void reportPairs(DetectorState &state, const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, DetectionCallback &dc)
+  {
+    findCandidatePairs(state, scene, qs, qe, state.m_pppairs, state.m_pepairs, state.m_phpairs);
+
+    // Batching handlers get the pairs as found; they do not expect follow-up
+    // pairs from particles they move, so no tracking is needed
+    BatchDetectionCallback *batch = dynamic_cast<BatchDetectionCallback*>(&dc);
+    if( batch != NULL )
+    {
+      deliverBatches(state, *batch);
+      return;
+    }
+
+    state.m_ppwalk.reset();
+    state.m_pewalk.reset();
+    state.m_phwalk.reset();
+    state.m_tracker.reset(state, scene, qs, qe);
+
+    int first, second;
+    while( state.m_ppwalk.next(first, second) )
+    {
+      dc.ParticleParticleCallback(first, second);
+      const int particles[] = { first, second };
+      state.m_tracker.update(particles, 2);
+    }
+
+    while( state.m_pewalk.next(first, second) )
+    {
+      dc.ParticleEdgeCallback(first, second);
+      const int particles[] = { first, state.m_edge_ends[2*second], state.m_edge_ends[2*second+1] };
+      state.m_tracker.update(particles, 3);
+    }
+
+    while( state.m_phwalk.next(first, second) )
+    {
+      dc.ParticleHalfplaneCallback(first, second);
+      const int particles[] = { first };
+      state.m_tracker.update(particles, 1);
+    }
+  }
+}
+
+ContestDetector::~ContestDetector()
+{
+  std::lock_guard<std::mutex> lock(g_states_mutex);
+  std::map<const ContestDetector*, DetectorState*>::iterator state = g_states.find(this);
+  if( state == g_states.end() ) return;
+  delete state->second;
+  g_states.erase(state);
+}
+
+void ContestDetector::performCollisionDetection(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, DetectionCallback &dc)
+{
+  // A callback that runs this detector again gets a state of its own, so
+  // the walk it was called from carries on undisturbed
+  DetectorState &own = stateOf(this);
+  DetectorState *nested = own.m_busy ? new DetectorState : NULL;
+  DetectorState &state = nested != NULL ? *nested : own;
+
+  state.m_busy = true;
+  reportPairs(state, scene, qs, qe, dc);
+  state.m_busy = false;
+  delete nested;
+}
 
 // Given particle positions, computes lists of *potentially* overlapping object
 // pairs. How exactly to do this is up to you.
@@ -21,4 +705,21 @@
 //            particle-halfplane overlaps.
 void ContestDetector::findCollidingPairs(const TwoDScene &scene, const VectorXs &x, PPList &pppairs, PEList &pepairs, PHList &phpairs)
 {
+  findCollidingPairs(scene, x, x, pppairs, pepairs, phpairs);
+}
+
+// As above, but for objects moving linearly from qs to qe
+void ContestDetector::findCollidingPairs(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, PPList &pppairs, PEList &pepairs, PHList &phpairs)
+{
+  findCandidatePairs(stateOf(this), scene, qs, qe, pppairs, pepairs, phpairs);
+}
+
+int ContestDetector::getNumIncidentPairsFiltered() const
+{
+  return stateOf(this).m_num_incident;
+}
+
+int ContestDetector::getNumNeighbourListBuilds() const
+{
+  return stateOf(this).m_num_near_builds;
 }
@@ -3,21 +3,31 @@
 
 #include "CollisionDetector.h"
 #include <vector>
-#include <set>
+#include "PairList.h"
 
-typedef std::set<std::pair<int, int> > PPList;
-typedef std::set<std::pair<int, int> > PEList;
-typedef std::set<std::pair<int, int> > PHList;
+typedef PairList PPList;
+typedef PairList PEList;
+typedef PairList PHList;
 
 class ContestDetector : public CollisionDetector
 {
  public:
   ContestDetector() {}
+  ~ContestDetector();
 
   virtual void performCollisionDetection(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, DetectionCallback &dc);
 
+  // Number of particle-edge candidates this detector's last neighbour list
+  // build dropped because the particle is an endpoint of the edge.
+  int getNumIncidentPairsFiltered() const;
+
+  // Number of times this detector has built its neighbour lists. They are
+  // reused between calls until some particle moves more than half their skin.
+  int getNumNeighbourListBuilds() const;
+
  private:
   void findCollidingPairs(const TwoDScene &scene, const VectorXs &x, PPList &pppairs, PEList &pepairs, PHList &phpairs);
+  void findCollidingPairs(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, PPList &pppairs, PEList &pepairs, PHList &phpairs);
 };
 
 #endif
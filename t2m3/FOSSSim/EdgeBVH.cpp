@@ -0,0 +1,196 @@
+#include "EdgeBVH.h"
+#include <algorithm>
+#include "TwoDScene.h"
+
+namespace
+{
+  // Maximum number of edges in a leaf
+  const int kLeafSize = 4;
+
+  scalar perimeter(const Vector2s &min, const Vector2s &max)
+  {
+    return 2.0*((max - min).x() + (max - min).y());
+  }
+
+  struct CentroidLess
+  {
+    CentroidLess(const std::vector<Vector2s> &min, const std::vector<Vector2s> &max, int axis)
+    : m_min(min)
+    , m_max(max)
+    , m_axis(axis)
+    {}
+
+    bool operator()(int a, int b) const
+    {
+      return m_min[a][m_axis] + m_max[a][m_axis] < m_min[b][m_axis] + m_max[b][m_axis];
+    }
+
+    const std::vector<Vector2s> &m_min;
+    const std::vector<Vector2s> &m_max;
+    int m_axis;
+  };
+}
+
+EdgeBVH::EdgeBVH(scalar rebuild_ratio)
+: m_rebuild_ratio(rebuild_ratio)
+, m_built_quality(0.0)
+, m_num_rebuilds(0)
+{
+  assert( m_rebuild_ratio >= 1.0 );
+}
+
+void EdgeBVH::update(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, scalar padding)
+{
+  const bool edges_changed = scene.getNumEdges() != (int) m_order.size();
+
+  computeEdgeBoxes(scene, qs, qe, padding);
+
+  if( edges_changed )
+  {
+    build();
+    return;
+  }
+
+  refit();
+  if( computeQuality() > m_rebuild_ratio*m_built_quality ) build();
+}
+
+void EdgeBVH::queryBox(const Vector2s &min, const Vector2s &max, std::vector<int> &edges) const
+{
+  const int nnodes = (int) m_nodes.size();
+  int i = 0;
+  while( i < nnodes )
+  {
+    const Node &node = m_nodes[i];
+    if( node.min.x() > max.x() || node.min.y() > max.y() || min.x() > node.max.x() || min.y() > node.max.y() )
+    {
+      i = node.skip;
+      continue;
+    }
+
+    for( int k = node.first; k < node.first + node.count; ++k )
+    {
+      const int e = m_order[k];
+      if( m_edge_min[e].x() <= max.x() && m_edge_min[e].y() <= max.y() && min.x() <= m_edge_max[e].x() && min.y() <= m_edge_max[e].y() )
+        edges.push_back(e);
+    }
+    ++i;
+  }
+}
+
+int EdgeBVH::getNumNodes() const
+{
+  return (int) m_nodes.size();
+}
+
+int EdgeBVH::getNumRebuilds() const
+{
+  return m_num_rebuilds;
+}
+
+void EdgeBVH::computeEdgeBoxes(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, scalar padding)
+{
+  const int nedges = scene.getNumEdges();
+  m_edge_min.resize(nedges);
+  m_edge_max.resize(nedges);
+  for( int e = 0; e < nedges; ++e )
+  {
+    const std::pair<int, int> &edge = scene.getEdge(e);
+    const scalar radius = scene.getEdgeRadii()[e] + padding;
+    Vector2s r(radius, radius);
+    m_edge_min[e] = qs.segment<2>(2*edge.first).cwiseMin(qe.segment<2>(2*edge.first)).cwiseMin(qs.segment<2>(2*edge.second)).cwiseMin(qe.segment<2>(2*edge.second)) - r;
+    m_edge_max[e] = qs.segment<2>(2*edge.first).cwiseMax(qe.segment<2>(2*edge.first)).cwiseMax(qs.segment<2>(2*edge.second)).cwiseMax(qe.segment<2>(2*edge.second)) + r;
+  }
+}
+
+void EdgeBVH::build()
+{
+  const int nedges = (int) m_edge_min.size();
+  m_order.resize(nedges);
+  for( int e = 0; e < nedges; ++e ) m_order[e] = e;
+
+  m_nodes.clear();
+  if( nedges > 0 ) buildNode(0, nedges);
+
+  m_built_quality = computeQuality();
+  ++m_num_rebuilds;
+}
+
+void EdgeBVH::buildNode(int begin, int end)
+{
+  Vector2s min = m_edge_min[m_order[begin]];
+  Vector2s max = m_edge_max[m_order[begin]];
+  Vector2s cmin = min + max;
+  Vector2s cmax = cmin;
+  for( int k = begin + 1; k < end; ++k )
+  {
+    const int e = m_order[k];
+    min = min.cwiseMin(m_edge_min[e]);
+    max = max.cwiseMax(m_edge_max[e]);
+    cmin = cmin.cwiseMin(m_edge_min[e] + m_edge_max[e]);
+    cmax = cmax.cwiseMax(m_edge_min[e] + m_edge_max[e]);
+  }
+
+  const int idx = (int) m_nodes.size();
+  Node node;
+  node.min = min;
+  node.max = max;
+  node.skip = idx + 1;
+  node.first = begin;
+  node.count = 0;
+  m_nodes.push_back(node);
+
+  if( end - begin <= kLeafSize )
+  {
+    m_nodes[idx].count = end - begin;
+    return;
+  }
+
+  // Median split along the longest axis of the centroids
+  const int axis = (cmax - cmin).x() >= (cmax - cmin).y() ? 0 : 1;
+  const int mid = begin + (end - begin)/2;
+  std::nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end, CentroidLess(m_edge_min, m_edge_max, axis));
+
+  buildNode(begin, mid);
+  buildNode(mid, end);
+  m_nodes[idx].skip = (int) m_nodes.size();
+}
+
+void EdgeBVH::refit()
+{
+  // In preorder children follow their parent, so a reverse pass sees every
+  // child before its parent. The left child is the next node and the right
+  // child starts where the left subtree ends.
+  for( int i = (int) m_nodes.size() - 1; i >= 0; --i )
+  {
+    Node &node = m_nodes[i];
+    if( node.count > 0 )
+    {
+      node.min = m_edge_min[m_order[node.first]];
+      node.max = m_edge_max[m_order[node.first]];
+      for( int k = node.first + 1; k < node.first + node.count; ++k )
+      {
+        node.min = node.min.cwiseMin(m_edge_min[m_order[k]]);
+        node.max = node.max.cwiseMax(m_edge_max[m_order[k]]);
+      }
+    }
+    else
+    {
+      const Node &left = m_nodes[i + 1];
+      const Node &right = m_nodes[left.skip];
+      node.min = left.min.cwiseMin(right.min);
+      node.max = left.max.cwiseMax(right.max);
+    }
+  }
+}
+
+scalar EdgeBVH::computeQuality() const
+{
+  scalar edges = 0.0;
+  for( std::vector<Vector2s>::size_type e = 0; e < m_edge_min.size(); ++e ) edges += perimeter(m_edge_min[e], m_edge_max[e]);
+
+  scalar nodes = 0.0;
+  for( std::vector<Node>::size_type i = 0; i < m_nodes.size(); ++i ) nodes += perimeter(m_nodes[i].min, m_nodes[i].max);
+
+  return edges > 0.0 ? nodes/edges : 0.0;
+}
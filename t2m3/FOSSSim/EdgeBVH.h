@@ -0,0 +1,71 @@
+#ifndef EDGE_BVH_H
+#define EDGE_BVH_H
+
+#include <vector>
+#include "MathDefs.h"
+
+class TwoDScene;
+
+// Bounding volume hierarchy over a scene's edges. Edge sizes vary by orders
+// of magnitude (thin ribbon links next to a long fixed floor), which no single
+// grid cell size suits, while a hierarchy adapts to them.
+//
+// Edge topology does not change during a simulation, so the tree is built once
+// and then only refitted bottom-up from the new positions. Refitting keeps the
+// tree valid but it degrades as edges move apart; the quality is measured as
+// the summed node perimeters relative to the summed edge box perimeters, and
+// the tree is rebuilt once that grows past a multiple of its value right
+// after the last build.
+//
+// Nodes are stored in depth-first preorder with a skip index to the node after
+// each subtree, so queries walk the array without a stack.
+class EdgeBVH
+{
+ public:
+  EdgeBVH(scalar rebuild_ratio = 1.5);
+
+  // Fits the tree to the edges' boxes swept from qs to qe and grown by
+  // padding, rebuilding it if the edges changed or the quality has degraded
+  // too far
+  void update(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, scalar padding = 0.0);
+
+  // Appends the indices of edges whose boxes overlap [min, max]
+  void queryBox(const Vector2s &min, const Vector2s &max, std::vector<int> &edges) const;
+
+  int getNumNodes() const;
+  int getNumRebuilds() const;
+
+ private:
+  struct Node
+  {
+    Vector2s min;
+    Vector2s max;
+    // Index of the node following this subtree in preorder
+    int skip;
+    // Leaves reference m_order[first, first + count); count is 0 for inner nodes
+    int first;
+    int count;
+  };
+
+  void computeEdgeBoxes(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, scalar padding);
+
+  void build();
+  void buildNode(int begin, int end);
+
+  void refit();
+
+  // Summed node perimeters over summed edge box perimeters
+  scalar computeQuality() const;
+
+  scalar m_rebuild_ratio;
+  scalar m_built_quality;
+  int m_num_rebuilds;
+
+  std::vector<Vector2s> m_edge_min;
+  std::vector<Vector2s> m_edge_max;
+
+  std::vector<Node> m_nodes;
+  std::vector<int> m_order;
+};
+
+#endif
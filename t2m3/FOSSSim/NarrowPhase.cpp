@@ -0,0 +1,169 @@
+#include "NarrowPhase.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NARROW_PHASE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  // Guards the closest point parameter against degenerate edges
+  const scalar kMinEdgeLengthSquared = 1.0e-12;
+
+  // The scalar kernels also finish the batches' last count % 4 candidates for
+  // the AVX2 kernels, starting at index first
+
+  void particleParticleDistancesScalar(const scalar *x, const int *i, const int *j, int first, int count, scalar *dist2)
+  {
+    for( int k = first; k < count; ++k )
+    {
+      const scalar dx = x[2*j[k]] - x[2*i[k]];
+      const scalar dy = x[2*j[k]+1] - x[2*i[k]+1];
+      dist2[k] = dx*dx + dy*dy;
+    }
+  }
+
+  void particleEdgeDistancesScalar(const scalar *x, const int *v, const int *a, const int *b, int first, int count, scalar *dist2)
+  {
+    for( int k = first; k < count; ++k )
+    {
+      const scalar ax = x[2*a[k]];
+      const scalar ay = x[2*a[k]+1];
+      const scalar ex = x[2*b[k]] - ax;
+      const scalar ey = x[2*b[k]+1] - ay;
+      const scalar rx = x[2*v[k]] - ax;
+      const scalar ry = x[2*v[k]+1] - ay;
+      const scalar ee = ex*ex + ey*ey;
+      const scalar alpha = std::min( std::max( ( rx*ex + ry*ey )/std::max( ee, kMinEdgeLengthSquared ), (scalar) 0.0 ), (scalar) 1.0 );
+      const scalar dx = rx - alpha*ex;
+      const scalar dy = ry - alpha*ey;
+      dist2[k] = dx*dx + dy*dy;
+    }
+  }
+
+  void particleHalfplaneDistancesScalar(const scalar *x, const int *v, const int *h, const scalar *planes, int first, int count, scalar *dist)
+  {
+    for( int k = first; k < count; ++k )
+    {
+      const scalar *plane = planes + 4*h[k];
+      dist[k] = ( x[2*v[k]] - plane[0] )*plane[2] + ( x[2*v[k]+1] - plane[1] )*plane[3];
+    }
+  }
+
+#ifdef NARROW_PHASE_AVX2
+  // Operand orders of the min and max intrinsics are chosen to match
+  // std::min and std::max, including which argument a NaN propagates from
+
+  // Loads four indices and scales them to offsets of x components
+  __attribute__((target("avx2"))) inline __m128i componentOffsets(const int *idx)
+  {
+    const __m128i i = _mm_loadu_si128( reinterpret_cast<const __m128i*>( idx ) );
+    return _mm_add_epi32( i, i );
+  }
+
+  // The masked form of the gather, with every lane enabled, avoids the
+  // unmasked intrinsic's uninitialized source operand
+  __attribute__((target("avx2"))) inline __m256d gather(const scalar *base, __m128i offsets)
+  {
+    const __m256d all = _mm256_castsi256_pd( _mm256_set1_epi64x( -1 ) );
+    return _mm256_mask_i32gather_pd( _mm256_setzero_pd(), base, offsets, all, 8 );
+  }
+
+  __attribute__((target("avx2"))) void particleParticleDistancesAVX2(const scalar *x, const int *i, const int *j, int count, scalar *dist2)
+  {
+    int k = 0;
+    for( ; k + 4 <= count; k += 4 )
+    {
+      const __m128i oi = componentOffsets( i + k );
+      const __m128i oj = componentOffsets( j + k );
+      const __m256d dx = _mm256_sub_pd( gather( x, oj ), gather( x, oi ) );
+      const __m256d dy = _mm256_sub_pd( gather( x + 1, oj ), gather( x + 1, oi ) );
+      _mm256_storeu_pd( dist2 + k, _mm256_add_pd( _mm256_mul_pd( dx, dx ), _mm256_mul_pd( dy, dy ) ) );
+    }
+    particleParticleDistancesScalar( x, i, j, k, count, dist2 );
+  }
+
+  __attribute__((target("avx2"))) void particleEdgeDistancesAVX2(const scalar *x, const int *v, const int *a, const int *b, int count, scalar *dist2)
+  {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd( 1.0 );
+    const __m256d min_ee = _mm256_set1_pd( kMinEdgeLengthSquared );
+
+    int k = 0;
+    for( ; k + 4 <= count; k += 4 )
+    {
+      const __m128i ov = componentOffsets( v + k );
+      const __m128i oa = componentOffsets( a + k );
+      const __m128i ob = componentOffsets( b + k );
+      const __m256d ax = gather( x, oa );
+      const __m256d ay = gather( x + 1, oa );
+      const __m256d ex = _mm256_sub_pd( gather( x, ob ), ax );
+      const __m256d ey = _mm256_sub_pd( gather( x + 1, ob ), ay );
+      const __m256d rx = _mm256_sub_pd( gather( x, ov ), ax );
+      const __m256d ry = _mm256_sub_pd( gather( x + 1, ov ), ay );
+      const __m256d ee = _mm256_add_pd( _mm256_mul_pd( ex, ex ), _mm256_mul_pd( ey, ey ) );
+      const __m256d re = _mm256_add_pd( _mm256_mul_pd( rx, ex ), _mm256_mul_pd( ry, ey ) );
+      const __m256d t = _mm256_div_pd( re, _mm256_max_pd( min_ee, ee ) );
+      const __m256d alpha = _mm256_min_pd( one, _mm256_max_pd( zero, t ) );
+      const __m256d dx = _mm256_sub_pd( rx, _mm256_mul_pd( alpha, ex ) );
+      const __m256d dy = _mm256_sub_pd( ry, _mm256_mul_pd( alpha, ey ) );
+      _mm256_storeu_pd( dist2 + k, _mm256_add_pd( _mm256_mul_pd( dx, dx ), _mm256_mul_pd( dy, dy ) ) );
+    }
+    particleEdgeDistancesScalar( x, v, a, b, k, count, dist2 );
+  }
+
+  __attribute__((target("avx2"))) void particleHalfplaneDistancesAVX2(const scalar *x, const int *v, const int *h, const scalar *planes, int count, scalar *dist)
+  {
+    int k = 0;
+    for( ; k + 4 <= count; k += 4 )
+    {
+      const __m128i ov = componentOffsets( v + k );
+      const __m128i hi = _mm_loadu_si128( reinterpret_cast<const __m128i*>( h + k ) );
+      const __m128i oh = _mm_slli_epi32( hi, 2 );
+      const __m256d px = gather( planes, oh );
+      const __m256d py = gather( planes + 1, oh );
+      const __m256d nx = gather( planes + 2, oh );
+      const __m256d ny = gather( planes + 3, oh );
+      const __m256d dx = _mm256_sub_pd( gather( x, ov ), px );
+      const __m256d dy = _mm256_sub_pd( gather( x + 1, ov ), py );
+      _mm256_storeu_pd( dist + k, _mm256_add_pd( _mm256_mul_pd( dx, nx ), _mm256_mul_pd( dy, ny ) ) );
+    }
+    particleHalfplaneDistancesScalar( x, v, h, planes, k, count, dist );
+  }
+#endif
+}
+
+void NarrowPhase::particleParticleDistances(const scalar *x, const int *i, const int *j, int count, scalar *dist2)
+{
+#ifdef NARROW_PHASE_AVX2
+  if( usingAVX2() ) { particleParticleDistancesAVX2(x, i, j, count, dist2); return; }
+#endif
+  particleParticleDistancesScalar(x, i, j, 0, count, dist2);
+}
+
+void NarrowPhase::particleEdgeDistances(const scalar *x, const int *v, const int *a, const int *b, int count, scalar *dist2)
+{
+#ifdef NARROW_PHASE_AVX2
+  if( usingAVX2() ) { particleEdgeDistancesAVX2(x, v, a, b, count, dist2); return; }
+#endif
+  particleEdgeDistancesScalar(x, v, a, b, 0, count, dist2);
+}
+
+void NarrowPhase::particleHalfplaneDistances(const scalar *x, const int *v, const int *h, const scalar *planes, int count, scalar *dist)
+{
+#ifdef NARROW_PHASE_AVX2
+  if( usingAVX2() ) { particleHalfplaneDistancesAVX2(x, v, h, planes, count, dist); return; }
+#endif
+  particleHalfplaneDistancesScalar(x, v, h, planes, 0, count, dist);
+}
+
+bool NarrowPhase::usingAVX2()
+{
+#ifdef NARROW_PHASE_AVX2
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+#else
+  return false;
+#endif
+}
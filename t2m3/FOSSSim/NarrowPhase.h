@@ -0,0 +1,32 @@
+#ifndef NARROW_PHASE_H
+#define NARROW_PHASE_H
+
+#include "MathDefs.h"
+
+// Distance kernels for batches of candidate pairs, indexed into a flat
+// position array (particle i at x[2*i], x[2*i+1]). On x86 CPUs with AVX2 four
+// candidates are processed at once, with their positions fetched by gather
+// loads; elsewhere a scalar loop is used. Both paths do the same operations in
+// the same order, so their results are bitwise identical as long as the build
+// does not let the compiler contract them into fused multiply-adds (the
+// default unless compiling for FMA capable targets).
+class NarrowPhase
+{
+ public:
+  // dist2[k] = squared distance between particles i[k] and j[k]
+  static void particleParticleDistances(const scalar *x, const int *i, const int *j, int count, scalar *dist2);
+
+  // dist2[k] = squared distance between particle v[k] and the closest point
+  // of the segment from particle a[k] to particle b[k]
+  static void particleEdgeDistances(const scalar *x, const int *v, const int *a, const int *b, int count, scalar *dist2);
+
+  // dist[k] = signed distance from particle v[k] to halfplane h[k]. Halfplane
+  // h is given by planes[4*h .. 4*h+3] = (px, py, nx, ny), a point on its
+  // boundary and its unit normal.
+  static void particleHalfplaneDistances(const scalar *x, const int *v, const int *h, const scalar *planes, int count, scalar *dist);
+
+  // Whether the AVX2 kernels are in use on this machine
+  static bool usingAVX2();
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "PairList.h"
+#include <algorithm>
+
+namespace
+{
+  // Below this many keys a comparison sort beats the radix passes
+  const std::vector<PairList::Key>::size_type kRadixSortMinSize = 256;
+
+  const int kDigitBits = 8;
+  const int kNumDigits = 64/kDigitBits;
+  const int kNumBuckets = 1 << kDigitBits;
+}
+
+void PairList::sortAndRemoveDuplicates()
+{
+  const std::vector<Key>::size_type n = m_keys.size();
+
+  if( n < kRadixSortMinSize )
+  {
+    std::sort(m_keys.begin(), m_keys.end());
+  }
+  else
+  {
+    // Least significant digit first; all digit histograms are gathered in a
+    // single pass over the keys
+    std::vector<Key>::size_type counts[kNumDigits][kNumBuckets] = {};
+    for( std::vector<Key>::size_type i = 0; i < n; ++i )
+      for( int d = 0; d < kNumDigits; ++d )
+        ++counts[d][(m_keys[i] >> (d*kDigitBits)) & (kNumBuckets - 1)];
+
+    m_scratch.resize(n);
+    for( int d = 0; d < kNumDigits; ++d )
+    {
+      const int shift = d*kDigitBits;
+
+      // Indices are small, so most high digits are the same for every key
+      // and their passes can be skipped
+      if( counts[d][(m_keys[0] >> shift) & (kNumBuckets - 1)] == n ) continue;
+
+      std::vector<Key>::size_type offset = 0;
+      for( int b = 0; b < kNumBuckets; ++b )
+      {
+        std::vector<Key>::size_type count = counts[d][b];
+        counts[d][b] = offset;
+        offset += count;
+      }
+
+      for( std::vector<Key>::size_type i = 0; i < n; ++i )
+        m_scratch[counts[d][(m_keys[i] >> shift) & (kNumBuckets - 1)]++] = m_keys[i];
+      m_keys.swap(m_scratch);
+    }
+  }
+
+  m_keys.erase(std::unique(m_keys.begin(), m_keys.end()), m_keys.end());
+}
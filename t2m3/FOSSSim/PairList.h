@@ -0,0 +1,40 @@
+#ifndef PAIR_LIST_H
+#define PAIR_LIST_H
+
+#include <vector>
+
+// Flat list of (int, int) pairs, each packed into a 64 bit key with the first
+// index in the high word, so sorting the keys orders the pairs the same way
+// std::pair does. Pairs are appended in any order and then sorted and
+// deduplicated in one pass. The buffers keep their capacity when cleared, so
+// a list reused every step stops allocating once it has grown.
+class PairList
+{
+ public:
+  typedef unsigned long long Key;
+
+  static Key pack(int first, int second) { return ((Key) (unsigned int) first << 32) | (unsigned int) second; }
+  static int first(Key key) { return (int) (key >> 32); }
+  static int second(Key key) { return (int) (key & 0xffffffffULL); }
+
+  void clear() { m_keys.clear(); }
+
+  // Indices must be non-negative
+  void insert(int first, int second) { m_keys.push_back(pack(first, second)); }
+
+  // Appends all pairs of another list, unsorted
+  void append(const PairList &other) { m_keys.insert(m_keys.end(), other.m_keys.begin(), other.m_keys.end()); }
+
+  // Sorts the pairs with a radix sort and removes duplicates
+  void sortAndRemoveDuplicates();
+
+  std::vector<Key>::size_type size() const { return m_keys.size(); }
+  bool empty() const { return m_keys.empty(); }
+  Key operator[](std::vector<Key>::size_type i) const { return m_keys[i]; }
+
+ private:
+  std::vector<Key> m_keys;
+  std::vector<Key> m_scratch;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Radius percentile the cell size is derived from
+  const scalar kRadiusPercentile = 0.9;
+}
+
+SpatialGrid::SpatialGrid()
+: m_origin(Vector2s::Zero())
+, m_h(1.0)
+, m_nx(0)
+, m_ny(0)
+{}
+
+void SpatialGrid::reset( const std::vector<Vector2s>& particle_min, const std::vector<Vector2s>& particle_max, const std::vector<scalar>& radii, scalar cell_size )
+{
+  assert( particle_min.size() == particle_max.size() );
+
+  m_pmin = particle_min;
+  m_pmax = particle_max;
+  m_particle_cells.clear();
+
+  const int nparticles = (int) m_pmin.size();
+  if( nparticles == 0 )
+  {
+    m_nx = m_ny = 0;
+    return;
+  }
+
+  Vector2s lo = m_pmin[0];
+  Vector2s hi = m_pmax[0];
+  for( int i = 1; i < nparticles; ++i )
+  {
+    lo = lo.cwiseMin( m_pmin[i] );
+    hi = hi.cwiseMax( m_pmax[i] );
+  }
+  const Vector2s extent = hi - lo;
+
+  m_h = cell_size;
+  if( !( m_h > 0.0 ) )
+  {
+    std::vector<scalar> sizes;
+    sizes.reserve( radii.size() );
+    for( std::vector<scalar>::size_type i = 0; i < radii.size(); ++i ) if( radii[i] > 0.0 ) sizes.push_back( radii[i] );
+    m_h = 0.0;
+    if( !sizes.empty() )
+    {
+      std::vector<scalar>::iterator q = sizes.begin() + (std::vector<scalar>::difference_type)( kRadiusPercentile*( sizes.size() - 1 ) );
+      std::nth_element( sizes.begin(), q, sizes.end() );
+      m_h = 2.0*(*q);
+    }
+
+    // Bound the number of cells per axis by a multiple of sqrt(number of
+    // particles)
+    scalar max_cells = 4.0*std::ceil( std::sqrt( scalar( nparticles ) ) ) + 1.0;
+    m_h = std::max( m_h, std::max( extent.x(), extent.y() )/max_cells );
+    if( !( m_h > 0.0 ) ) m_h = 1.0;
+  }
+
+  m_origin = lo;
+  m_nx = (int) std::floor( extent.x()/m_h ) + 1;
+  m_ny = (int) std::floor( extent.y()/m_h ) + 1;
+
+  for( int i = 0; i < nparticles; ++i )
+  {
+    int x0 = cellX( m_pmin[i].x() ), x1 = cellX( m_pmax[i].x() );
+    int y0 = cellY( m_pmin[i].y() ), y1 = cellY( m_pmax[i].y() );
+    for( int cy = y0; cy <= y1; ++cy )
+    {
+      for( int cx = x0; cx <= x1; ++cx )
+      {
+        Membership m;
+        m.cell = (long long) cy*m_nx + cx;
+        m.id = i;
+        m_particle_cells.push_back(m);
+      }
+    }
+  }
+
+  std::sort( m_particle_cells.begin(), m_particle_cells.end() );
+}
+
+void SpatialGrid::findParticleParticlePairs( PairList& pairs ) const
+{
+  findParticleParticlePairs( pairs, 0, 1 );
+}
+
+void SpatialGrid::findParticleParticlePairs( PairList& pairs, int part, int nparts ) const
+{
+  assert( part >= 0 && part < nparts );
+
+  const int n = (int) m_particle_cells.size();
+  const int first = partBoundary( part, nparts );
+  const int last = partBoundary( part + 1, nparts );
+  for( int begin = first; begin < last; )
+  {
+    const long long cell = m_particle_cells[begin].cell;
+    int end = begin + 1;
+    while( end < n && m_particle_cells[end].cell == cell ) ++end;
+
+    for( int a = begin; a < end; ++a )
+    {
+      const int i = m_particle_cells[a].id;
+      for( int b = a + 1; b < end; ++b )
+      {
+        const int j = m_particle_cells[b].id;
+        if( !boxesOverlap( i, j ) ) continue;
+        // Only report the pair from the cell containing the minimum corner of the boxes' intersection
+        Vector2s corner = m_pmin[i].cwiseMax( m_pmin[j] );
+        if( (long long) cellY( corner.y() )*m_nx + cellX( corner.x() ) != cell ) continue;
+        pairs.insert( std::min( i, j ), std::max( i, j ) );
+      }
+    }
+
+    begin = end;
+  }
+}
+
+void SpatialGrid::queryBox( const Vector2s& min, const Vector2s& max, std::vector<int>& particles ) const
+{
+  if( m_nx == 0 ) return;
+
+  const std::vector<int>::size_type first = particles.size();
+  const int x0 = cellX( min.x() ), x1 = cellX( max.x() );
+  const int y0 = cellY( min.y() ), y1 = cellY( max.y() );
+  for( int cy = y0; cy <= y1; ++cy )
+  {
+    // Cells of a row are contiguous in key order, so one search finds the
+    // start of the row's range
+    Membership key;
+    key.cell = (long long) cy*m_nx + x0;
+    key.id = -1;
+    const long long last = (long long) cy*m_nx + x1;
+    for( std::vector<Membership>::const_iterator it = std::lower_bound( m_particle_cells.begin(), m_particle_cells.end(), key ); it != m_particle_cells.end() && it->cell <= last; ++it )
+      particles.push_back( it->id );
+  }
+
+  std::sort( particles.begin() + first, particles.end() );
+  particles.erase( std::unique( particles.begin() + first, particles.end() ), particles.end() );
+}
+
+scalar SpatialGrid::getCellSize() const
+{
+  return m_h;
+}
+
+int SpatialGrid::getNumCells() const
+{
+  return m_nx*m_ny;
+}
+
+int SpatialGrid::cellX( scalar x ) const
+{
+  int c = (int) std::floor( ( x - m_origin.x() )/m_h );
+  return std::min( std::max( c, 0 ), m_nx - 1 );
+}
+
+int SpatialGrid::cellY( scalar y ) const
+{
+  int c = (int) std::floor( ( y - m_origin.y() )/m_h );
+  return std::min( std::max( c, 0 ), m_ny - 1 );
+}
+
+bool SpatialGrid::boxesOverlap( int i, int j ) const
+{
+  return m_pmin[i].x() <= m_pmax[j].x() && m_pmin[j].x() <= m_pmax[i].x() && m_pmin[i].y() <= m_pmax[j].y() && m_pmin[j].y() <= m_pmax[i].y();
+}
+
+int SpatialGrid::partBoundary( int part, int nparts ) const
+{
+  const int n = (int) m_particle_cells.size();
+  int index = (int) ( (long long) n*part/nparts );
+  while( index > 0 && index < n && m_particle_cells[index-1].cell == m_particle_cells[index].cell ) ++index;
+  return index;
+}
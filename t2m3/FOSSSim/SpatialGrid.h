@@ -0,0 +1,72 @@
+#ifndef __SPATIAL_GRID_H__
+#define __SPATIAL_GRID_H__
+
+#include <vector>
+
+#include "MathDefs.h"
+#include "PairList.h"
+
+// Uniform grid broad phase for particles. Edges vary too much in size for a
+// single cell size and are handled by EdgeBVH instead.
+//
+// Rather than hashing, the (cell, particle) memberships are generated into a
+// flat array and sorted by cell, so a cell's contents are contiguous and there
+// are no hash collisions to filter. Particles are inserted into every cell
+// their bounding box overlaps. A pair is only reported from the cell holding
+// the minimum corner of the two boxes' intersection, so it is reported once.
+class SpatialGrid
+{
+public:
+  SpatialGrid();
+
+  // Bins the given particle boxes. If cell_size is not positive it is chosen
+  // from the radii: twice their 90th percentile, so that most particles span
+  // at most 2x2 cells, coarsened if needed so a sparse scene does not get an
+  // enormous grid.
+  void reset( const std::vector<Vector2s>& particle_min, const std::vector<Vector2s>& particle_max, const std::vector<scalar>& radii, scalar cell_size = -1.0 );
+
+  // Appends each pair of particles with overlapping boxes once, with
+  // first < second
+  void findParticleParticlePairs( PairList& pairs ) const;
+
+  // As above, but only for the cells in part [part, part+1) of nparts
+  // roughly equal slices of the occupied cells. The parts together report
+  // every pair exactly once and can be run concurrently.
+  void findParticleParticlePairs( PairList& pairs, int part, int nparts ) const;
+
+  // Appends the particles sharing a cell with the box [min, max], each once.
+  // These are candidates only, their boxes need not overlap the query box.
+  void queryBox( const Vector2s& min, const Vector2s& max, std::vector<int>& particles ) const;
+
+  scalar getCellSize() const;
+  int getNumCells() const;
+
+private:
+  struct Membership
+  {
+    long long cell;
+    int id;
+    bool operator<( const Membership& other ) const { return cell < other.cell || ( cell == other.cell && id < other.id ); }
+  };
+
+  int cellX( scalar x ) const;
+  int cellY( scalar y ) const;
+
+  bool boxesOverlap( int i, int j ) const;
+
+  // Index into m_particle_cells where part begins, moved forward to the
+  // start of a cell so no cell is split between parts
+  int partBoundary( int part, int nparts ) const;
+
+  Vector2s m_origin;
+  scalar m_h;
+  int m_nx;
+  int m_ny;
+
+  std::vector<Vector2s> m_pmin;
+  std::vector<Vector2s> m_pmax;
+
+  std::vector<Membership> m_particle_cells;
+};
+
+#endif
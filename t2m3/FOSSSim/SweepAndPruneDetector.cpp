@@ -0,0 +1,252 @@
+#include "SweepAndPruneDetector.h"
+#include <algorithm>
+#include "TwoDScene.h"
+#include "BatchDetectionCallback.h"
+
+namespace
+{
+  // Splits a pair list into the two index arrays of a batch
+  void unpackPairs(const std::vector<std::pair<int, int> > &pairs, std::vector<int> &first, std::vector<int> &second)
+  {
+    first.resize(pairs.size());
+    second.resize(pairs.size());
+    for( std::vector<std::pair<int, int> >::size_type i = 0; i < pairs.size(); ++i )
+    {
+      first[i] = pairs[i].first;
+      second[i] = pairs[i].second;
+    }
+  }
+}
+
+SweepAndPruneDetector::SweepAndPruneDetector()
+: CollisionDetector()
+, m_num_particles(-1)
+, m_num_edges(-1)
+, m_num_swaps(0)
+, m_num_incident(0)
+{}
+
+void SweepAndPruneDetector::performCollisionDetection(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, DetectionCallback &dc)
+{
+  assert( qs.size() == qe.size() );
+  assert( qs.size() == 2*scene.getNumParticles() );
+
+  computeBoxes(scene, qs, qe);
+
+  bool rebuilt = false;
+  if( scene.getNumParticles() != m_num_particles || scene.getNumEdges() != m_num_edges )
+  {
+    rebuilt = true;
+    m_num_particles = scene.getNumParticles();
+    m_num_edges = scene.getNumEdges();
+    rebuildEndpoints(m_num_particles + m_num_edges);
+  }
+
+  m_num_swaps = 0;
+  m_num_incident = 0;
+  updateAndSort(m_endpoints[0], 0, rebuilt);
+  updateAndSort(m_endpoints[1], 1, rebuilt);
+
+  // Sweep along the axis the box centers are more spread out on; fewer boxes
+  // are active at a time there
+  Vector2s mean = Vector2s::Zero();
+  Vector2s meansq = Vector2s::Zero();
+  for( std::vector<Vector2s>::size_type i = 0; i < m_min.size(); ++i )
+  {
+    Vector2s c = 0.5*(m_min[i] + m_max[i]);
+    mean += c;
+    meansq += c.cwiseProduct(c);
+  }
+  Vector2s variance = meansq - mean.cwiseProduct(mean)/std::max((scalar) m_min.size(), 1.0);
+  int axis = variance.x() >= variance.y() ? 0 : 1;
+
+  std::vector<std::pair<int, int> > pppairs;
+  std::vector<std::pair<int, int> > pepairs;
+  sweep(scene, axis, pppairs, pepairs);
+
+  // Report in a deterministic order regardless of the sweep axis
+  std::sort(pppairs.begin(), pppairs.end());
+  std::sort(pepairs.begin(), pepairs.end());
+
+  // Signed distance to a halfplane is linear along the particle's path, so
+  // checking both ends of the motion is enough
+  std::vector<std::pair<int, int> > phpairs;
+  for( int h = 0; h < scene.getNumHalfplanes(); ++h )
+  {
+    const std::pair<VectorXs, VectorXs> &halfplane = scene.getHalfplane(h);
+    Vector2s n = halfplane.second.segment<2>(0).normalized();
+    for( int i = 0; i < scene.getNumParticles(); ++i )
+    {
+      scalar ds = (qs.segment<2>(2*i) - halfplane.first.segment<2>(0)).dot(n);
+      scalar de = (qe.segment<2>(2*i) - halfplane.first.segment<2>(0)).dot(n);
+      if( std::min(ds, de) <= scene.getRadius(i) + kContactTolerance )
+        phpairs.push_back(std::make_pair(i, h));
+    }
+  }
+
+  BatchDetectionCallback *batch = dynamic_cast<BatchDetectionCallback*>(&dc);
+  if( batch != NULL )
+  {
+    unpackPairs(pppairs, m_batch_first, m_batch_second);
+    if( !pppairs.empty() ) batch->ParticleParticleBatch(&m_batch_first[0], &m_batch_second[0], (int) pppairs.size());
+    unpackPairs(pepairs, m_batch_first, m_batch_second);
+    if( !pepairs.empty() ) batch->ParticleEdgeBatch(&m_batch_first[0], &m_batch_second[0], (int) pepairs.size());
+    unpackPairs(phpairs, m_batch_first, m_batch_second);
+    if( !phpairs.empty() ) batch->ParticleHalfplaneBatch(&m_batch_first[0], &m_batch_second[0], (int) phpairs.size());
+    return;
+  }
+
+  for( std::vector<std::pair<int, int> >::size_type i = 0; i < pppairs.size(); ++i )
+    dc.ParticleParticleCallback(pppairs[i].first, pppairs[i].second);
+
+  for( std::vector<std::pair<int, int> >::size_type i = 0; i < pepairs.size(); ++i )
+    dc.ParticleEdgeCallback(pepairs[i].first, pepairs[i].second);
+
+  for( std::vector<std::pair<int, int> >::size_type i = 0; i < phpairs.size(); ++i )
+    dc.ParticleHalfplaneCallback(phpairs[i].first, phpairs[i].second);
+}
+
+int SweepAndPruneDetector::getNumSwaps() const
+{
+  return m_num_swaps;
+}
+
+int SweepAndPruneDetector::getNumIncidentPairsFiltered() const
+{
+  return m_num_incident;
+}
+
+void SweepAndPruneDetector::computeBoxes(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe)
+{
+  const int nparticles = scene.getNumParticles();
+  const int nedges = scene.getNumEdges();
+  m_min.resize(nparticles + nedges);
+  m_max.resize(nparticles + nedges);
+
+  for( int i = 0; i < nparticles; ++i )
+  {
+    Vector2s r(scene.getRadius(i) + kContactTolerance, scene.getRadius(i) + kContactTolerance);
+    m_min[i] = qs.segment<2>(2*i).cwiseMin(qe.segment<2>(2*i)) - r;
+    m_max[i] = qs.segment<2>(2*i).cwiseMax(qe.segment<2>(2*i)) + r;
+  }
+
+  for( int e = 0; e < nedges; ++e )
+  {
+    const std::pair<int, int> &edge = scene.getEdge(e);
+    Vector2s r(scene.getEdgeRadii()[e], scene.getEdgeRadii()[e]);
+    Vector2s lo = qs.segment<2>(2*edge.first).cwiseMin(qe.segment<2>(2*edge.first)).cwiseMin(qs.segment<2>(2*edge.second)).cwiseMin(qe.segment<2>(2*edge.second));
+    Vector2s hi = qs.segment<2>(2*edge.first).cwiseMax(qe.segment<2>(2*edge.first)).cwiseMax(qs.segment<2>(2*edge.second)).cwiseMax(qe.segment<2>(2*edge.second));
+    m_min[nparticles + e] = lo - r;
+    m_max[nparticles + e] = hi + r;
+  }
+}
+
+void SweepAndPruneDetector::rebuildEndpoints(int nobjects)
+{
+  for( int axis = 0; axis < 2; ++axis )
+  {
+    m_endpoints[axis].resize(2*nobjects);
+    for( int i = 0; i < nobjects; ++i )
+    {
+      m_endpoints[axis][2*i].object = i;
+      m_endpoints[axis][2*i].is_min = true;
+      m_endpoints[axis][2*i+1].object = i;
+      m_endpoints[axis][2*i+1].is_min = false;
+    }
+  }
+}
+
+void SweepAndPruneDetector::updateAndSort(std::vector<Endpoint> &endpoints, int axis, bool full_sort)
+{
+  for( std::vector<Endpoint>::size_type i = 0; i < endpoints.size(); ++i )
+    endpoints[i].value = endpoints[i].is_min ? m_min[endpoints[i].object][axis] : m_max[endpoints[i].object][axis];
+
+  // Freshly built lists have no useful order yet
+  if( full_sort )
+  {
+    std::sort(endpoints.begin(), endpoints.end());
+    return;
+  }
+
+  // Insertion sort: near linear when the previous order is almost right
+  for( std::vector<Endpoint>::size_type i = 1; i < endpoints.size(); ++i )
+  {
+    Endpoint key = endpoints[i];
+    std::vector<Endpoint>::size_type j = i;
+    while( j > 0 && key < endpoints[j-1] )
+    {
+      endpoints[j] = endpoints[j-1];
+      --j;
+      ++m_num_swaps;
+    }
+    endpoints[j] = key;
+  }
+}
+
+void SweepAndPruneDetector::sweep(const TwoDScene &scene, int axis, std::vector<std::pair<int, int> > &pppairs, std::vector<std::pair<int, int> > &pepairs)
+{
+  const int other = 1 - axis;
+  const std::vector<Endpoint> &endpoints = m_endpoints[axis];
+
+  // Active particles and edges are kept apart, edges never pair with edges.
+  // slot maps an object to its position in its active list for O(1) removal.
+  std::vector<int> active_particles;
+  std::vector<int> active_edges;
+  std::vector<int> slot(m_num_particles + m_num_edges, -1);
+
+  for( std::vector<Endpoint>::size_type i = 0; i < endpoints.size(); ++i )
+  {
+    const int a = endpoints[i].object;
+    const bool is_particle = a < m_num_particles;
+    std::vector<int> &active = is_particle ? active_particles : active_edges;
+
+    if( !endpoints[i].is_min )
+    {
+      int s = slot[a];
+      slot[active.back()] = s;
+      active[s] = active.back();
+      active.pop_back();
+      continue;
+    }
+
+    for( std::vector<int>::size_type k = 0; k < active_particles.size(); ++k )
+    {
+      const int b = active_particles[k];
+      if( !overlapOnAxis(a, b, other) ) continue;
+      if( is_particle )
+      {
+        pppairs.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+      }
+      else
+      {
+        const int e = a - m_num_particles;
+        if( scene.getEdge(e).first != b && scene.getEdge(e).second != b )
+          pepairs.push_back(std::make_pair(b, e));
+        else
+          ++m_num_incident;
+      }
+    }
+
+    if( is_particle )
+    {
+      for( std::vector<int>::size_type k = 0; k < active_edges.size(); ++k )
+      {
+        const int b = active_edges[k];
+        if( !overlapOnAxis(a, b, other) ) continue;
+        const int e = b - m_num_particles;
+        if( scene.getEdge(e).first != a && scene.getEdge(e).second != a )
+          pepairs.push_back(std::make_pair(a, e));
+        else
+          ++m_num_incident;
+      }
+    }
+
+    slot[a] = (int) active.size();
+    active.push_back(a);
+  }
+}
+
+bool SweepAndPruneDetector::overlapOnAxis(int a, int b, int axis) const
+{
+  return m_min[a][axis] <= m_max[b][axis] && m_min[b][axis] <= m_max[a][axis];
+}
@@ -0,0 +1,75 @@
+#ifndef SWEEP_AND_PRUNE_DETECTOR_H
+#define SWEEP_AND_PRUNE_DETECTOR_H
+
+#include "CollisionDetector.h"
+#include <vector>
+
+// Sort-and-sweep broad phase over the axis aligned boxes of particles and
+// edges. The boxes cover the motion from qs to qe, so the detector is usable
+// for continuous as well as discrete collision detection. Particle boxes and
+// halfplane distances get the same kContactTolerance pad as ContestDetector's,
+// so both detectors report the same pairs.
+//
+// The sorted endpoint lists of both axes are kept from the previous call and
+// re-sorted with insertion sort. Between steps objects move only slightly, so
+// this is close to linear time. The sweep runs along whichever axis the boxes
+// are more spread out on, and a pair is only reported if the boxes also
+// overlap on the other axis.
+class SweepAndPruneDetector : public CollisionDetector
+{
+ public:
+  SweepAndPruneDetector();
+
+  virtual void performCollisionDetection(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe, DetectionCallback &dc);
+
+  // Number of endpoint swaps done by the last call's insertion sorts. Under
+  // temporal coherence this stays a small multiple of the number of objects.
+  int getNumSwaps() const;
+
+  // Number of particle-edge pairs the last call dropped because the particle
+  // is an endpoint of the edge
+  int getNumIncidentPairsFiltered() const;
+
+ private:
+  struct Endpoint
+  {
+    scalar value;
+    // Particles are objects [0, num particles), edges follow
+    int object;
+    bool is_min;
+
+    // Min endpoints sort before max endpoints at the same value, so boxes
+    // that just touch count as overlapping
+    bool operator<(const Endpoint &other) const { return value < other.value || (value == other.value && is_min && !other.is_min); }
+  };
+
+  void computeBoxes(const TwoDScene &scene, const VectorXs &qs, const VectorXs &qe);
+
+  // Rebuilds the endpoint lists if the number of particles or edges changed
+  void rebuildEndpoints(int nobjects);
+
+  // Refreshes the endpoint values and restores the order, with insertion
+  // sort unless full_sort is set
+  void updateAndSort(std::vector<Endpoint> &endpoints, int axis, bool full_sort);
+
+  void sweep(const TwoDScene &scene, int axis, std::vector<std::pair<int, int> > &pppairs, std::vector<std::pair<int, int> > &pepairs);
+
+  bool overlapOnAxis(int a, int b, int axis) const;
+
+  int m_num_particles;
+  int m_num_edges;
+
+  std::vector<Vector2s> m_min;
+  std::vector<Vector2s> m_max;
+
+  std::vector<Endpoint> m_endpoints[2];
+
+  // Index arrays handed to a BatchDetectionCallback
+  std::vector<int> m_batch_first;
+  std::vector<int> m_batch_second;
+
+  int m_num_swaps;
+  int m_num_incident;
+};
+
+#endif
@@ -0,0 +1,385 @@
+#include "XPBDStepper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "TwoDScene.h"
+#include "SpringForce.h"
+#include "NarrowPhase.h"
+
+namespace
+{
+  const int kMaxColors = 64;
+  const scalar kEpsilon = 1.0e-12;
+  // Candidates farther apart than (1 + kContactMargin) times their minimum
+  // separation at the predicted positions are not turned into contacts
+  const scalar kContactMargin = 0.1;
+}
+
+XPBDStepper::ContactCollector::ContactCollector( const TwoDScene& scene, const VectorXs& p, std::vector<Constraint>& contacts )
+: BatchDetectionCallback()
+, m_scene(scene)
+, m_p(p)
+, m_contacts(contacts)
+, m_dist()
+, m_first()
+, m_second()
+, m_planes( 4*scene.getNumHalfplanes() )
+{
+  for( int h = 0; h < scene.getNumHalfplanes(); ++h )
+  {
+    const std::pair<VectorXs, VectorXs>& halfplane = scene.getHalfplane(h);
+    const Vector2s n = halfplane.second.segment<2>(0).normalized();
+    m_planes[4*h] = halfplane.first(0);
+    m_planes[4*h+1] = halfplane.first(1);
+    m_planes[4*h+2] = n.x();
+    m_planes[4*h+3] = n.y();
+  }
+}
+
+void XPBDStepper::ContactCollector::ParticleParticleCallback( int idx1, int idx2 )
+{
+  ParticleParticleBatch( &idx1, &idx2, 1 );
+}
+
+void XPBDStepper::ContactCollector::ParticleEdgeCallback( int vidx, int eidx )
+{
+  const std::pair<int,int>& edge = m_scene.getEdge(eidx);
+  if( edge.first == vidx || edge.second == vidx ) return;
+  ParticleEdgeBatch( &vidx, &eidx, 1 );
+}
+
+void XPBDStepper::ContactCollector::ParticleHalfplaneCallback( int vidx, int hidx )
+{
+  ParticleHalfplaneBatch( &vidx, &hidx, 1 );
+}
+
+// Distances come from the batch kernels in NarrowPhase; the loops here only
+// compare them against each pair's reach and append the contacts
+void XPBDStepper::ContactCollector::ParticleParticleBatch( const int* idx1, const int* idx2, int count )
+{
+  const std::vector<scalar>& radii = m_scene.getRadii();
+  m_dist.resize(count);
+  NarrowPhase::particleParticleDistances( m_p.data(), idx1, idx2, count, &m_dist[0] );
+
+  for( int k = 0; k < count; ++k )
+  {
+    const scalar l0 = radii[idx1[k]] + radii[idx2[k]];
+    const scalar reach = ( 1.0 + kContactMargin )*l0;
+    if( m_dist[k] < reach*reach ) addContact( PARTICLE_PARTICLE, idx1[k], idx2[k], -1, -1, l0 );
+  }
+}
+
+void XPBDStepper::ContactCollector::ParticleEdgeBatch( const int* vidx, const int* eidx, int count )
+{
+  const std::vector<scalar>& radii = m_scene.getRadii();
+  const std::vector<scalar>& edge_radii = m_scene.getEdgeRadii();
+  m_dist.resize(count);
+  m_first.resize(count);
+  m_second.resize(count);
+  for( int k = 0; k < count; ++k )
+  {
+    const std::pair<int,int>& edge = m_scene.getEdge(eidx[k]);
+    m_first[k] = edge.first;
+    m_second[k] = edge.second;
+  }
+  NarrowPhase::particleEdgeDistances( m_p.data(), vidx, &m_first[0], &m_second[0], count, &m_dist[0] );
+
+  for( int k = 0; k < count; ++k )
+  {
+    const scalar l0 = radii[vidx[k]] + edge_radii[eidx[k]];
+    const scalar reach = ( 1.0 + kContactMargin )*l0;
+    if( m_dist[k] < reach*reach ) addContact( PARTICLE_EDGE, vidx[k], m_first[k], m_second[k], -1, l0 );
+  }
+}
+
+void XPBDStepper::ContactCollector::ParticleHalfplaneBatch( const int* vidx, const int* hidx, int count )
+{
+  const std::vector<scalar>& radii = m_scene.getRadii();
+  m_dist.resize(count);
+  NarrowPhase::particleHalfplaneDistances( m_p.data(), vidx, hidx, &m_planes[0], count, &m_dist[0] );
+
+  for( int k = 0; k < count; ++k )
+  {
+    const scalar l0 = radii[vidx[k]];
+    if( m_dist[k] < ( 1.0 + kContactMargin )*l0 ) addContact( PARTICLE_HALFPLANE, vidx[k], -1, -1, hidx[k], l0 );
+  }
+}
+
+void XPBDStepper::ContactCollector::addContact( ConstraintType type, int p0, int p1, int p2, int halfplane, scalar l0 )
+{
+  Constraint c;
+  c.type = type;
+  c.p[0] = p0; c.p[1] = p1; c.p[2] = p2;
+  c.halfplane = halfplane;
+  c.l0 = l0;
+  c.compliance = 0.0; c.damping = 0.0; c.lambda = 0.0;
+  m_contacts.push_back(c);
+}
+
+XPBDStepper::XPBDStepper( CollisionDetector* detector, int iterations )
+: SceneStepper()
+, m_detector(detector)
+, m_iterations(iterations)
+{
+  assert( m_iterations > 0 );
+}
+
+XPBDStepper::~XPBDStepper()
+{}
+
+bool XPBDStepper::stepScene( TwoDScene& scene, scalar dt )
+{
+  VectorXs& x = scene.getX();
+  VectorXs& v = scene.getV();
+  const VectorXs& m = scene.getM();
+  assert( x.size() == v.size() );
+  assert( x.size() == m.size() );
+
+  int nparticles = scene.getNumParticles();
+
+  // The spring coloring skips fixed particles, so it is only race free for
+  // the fixed set it was built with
+  bool fixed_changed = (int) m_cached_fixed.size() != nparticles;
+  m_cached_fixed.resize(nparticles);
+  m_w.resize(nparticles);
+  for( int i = 0; i < nparticles; ++i )
+  {
+    const bool fixed = scene.isFixed(i);
+    fixed_changed = fixed_changed || m_cached_fixed[i] != fixed;
+    m_cached_fixed[i] = fixed;
+    m_w(i) = fixed ? 0.0 : 1.0/m(2*i);
+  }
+
+  if( fixed_changed || scene.getForces() != m_cached_forces ) buildSpringConstraints( scene );
+
+  // Explicitly integrate the forces that are not turned into constraints
+  if( !m_explicit_forces.empty() )
+  {
+    m_gradE.setZero(x.size());
+    for( std::vector<Force*>::size_type i = 0; i < m_explicit_forces.size(); ++i ) m_explicit_forces[i]->addGradEToTotal( x, v, m, m_gradE );
+    for( int i = 0; i < nparticles; ++i ) if( m_w(i) != 0.0 ) v.segment<2>(2*i) -= dt*m_w(i)*m_gradE.segment<2>(2*i);
+  }
+
+  // Predict positions
+  m_p = x;
+  for( int i = 0; i < nparticles; ++i ) if( m_w(i) != 0.0 ) m_p.segment<2>(2*i) += dt*v.segment<2>(2*i);
+
+  // Gather contacts at the predicted positions
+  m_contacts.clear();
+  if( m_detector != NULL )
+  {
+    ContactCollector collector( scene, m_p, m_contacts );
+    m_detector->performCollisionDetection( scene, m_p, m_p, collector );
+  }
+  colorConstraints( m_contacts, m_contact_order, m_contact_starts );
+
+  for( std::vector<Constraint>::size_type i = 0; i < m_springs.size(); ++i ) m_springs[i].lambda = 0.0;
+
+  for( int iter = 0; iter < m_iterations; ++iter )
+  {
+    solveGroups( m_springs, m_spring_order, m_spring_starts, scene, x, dt );
+    solveGroups( m_contacts, m_contact_order, m_contact_starts, scene, x, dt );
+  }
+
+  // Recover velocities from the corrected positions
+  for( int i = 0; i < nparticles; ++i )
+  {
+    if( m_w(i) == 0.0 ) continue;
+    v.segment<2>(2*i) = ( m_p.segment<2>(2*i) - x.segment<2>(2*i) )/dt;
+    x.segment<2>(2*i) = m_p.segment<2>(2*i);
+  }
+
+  return true;
+}
+
+std::string XPBDStepper::getName() const
+{
+  return "XPBD";
+}
+
+int XPBDStepper::getNumSpringColors() const
+{
+  return std::max( 0, (int) m_spring_starts.size() - 1 );
+}
+
+int XPBDStepper::getNumContacts() const
+{
+  return (int) m_contacts.size();
+}
+
+void XPBDStepper::buildSpringConstraints( const TwoDScene& scene )
+{
+  m_cached_forces = scene.getForces();
+  m_explicit_forces.clear();
+  m_springs.clear();
+
+  for( std::vector<Force*>::size_type i = 0; i < m_cached_forces.size(); ++i )
+  {
+    const SpringForce* spring = dynamic_cast<const SpringForce*>( m_cached_forces[i] );
+    if( spring == NULL || spring->getK() <= 0.0 )
+    {
+      m_explicit_forces.push_back( m_cached_forces[i] );
+      continue;
+    }
+
+    Constraint c;
+    c.type = DISTANCE;
+    c.p[0] = spring->getEndpoints().first; c.p[1] = spring->getEndpoints().second; c.p[2] = -1;
+    c.halfplane = -1;
+    c.l0 = spring->getL0();
+    c.compliance = 1.0/spring->getK();
+    c.damping = spring->getB();
+    c.lambda = 0.0;
+    m_springs.push_back(c);
+  }
+
+  colorConstraints( m_springs, m_spring_order, m_spring_starts );
+}
+
+void XPBDStepper::colorConstraints( const std::vector<Constraint>& constraints, std::vector<int>& order, std::vector<int>& starts )
+{
+  const int ncons = (int) constraints.size();
+
+  m_color_masks.assign( m_w.size(), 0ULL );
+  std::vector<int> colors( ncons );
+  std::vector<int> counts( kMaxColors + 1, 0 );
+
+  for( int c = 0; c < ncons; ++c )
+  {
+    unsigned long long used = 0ULL;
+    for( int k = 0; k < 3; ++k )
+    {
+      int p = constraints[c].p[k];
+      if( p >= 0 && m_w(p) != 0.0 ) used |= m_color_masks[p];
+    }
+
+    int color = kMaxColors;
+    if( ~used != 0ULL )
+    {
+      color = 0;
+      while( used & (1ULL << color) ) ++color;
+      for( int k = 0; k < 3; ++k )
+      {
+        int p = constraints[c].p[k];
+        if( p >= 0 && m_w(p) != 0.0 ) m_color_masks[p] |= (1ULL << color);
+      }
+    }
+    colors[c] = color;
+    ++counts[color];
+  }
+
+  // Drop trailing empty colors but keep the serial overflow group last
+  int ncolors = kMaxColors;
+  while( ncolors > 0 && counts[ncolors-1] == 0 ) --ncolors;
+
+  starts.assign( ncolors + 2, 0 );
+  for( int i = 0; i < ncolors; ++i ) starts[i+1] = starts[i] + counts[i];
+  starts[ncolors+1] = starts[ncolors] + counts[kMaxColors];
+
+  std::vector<int> fill( starts.begin(), starts.end() - 1 );
+  order.resize( ncons );
+  for( int c = 0; c < ncons; ++c ) order[ fill[ colors[c] == kMaxColors ? ncolors : colors[c] ]++ ] = c;
+}
+
+void XPBDStepper::solveGroups( std::vector<Constraint>& constraints, const std::vector<int>& order, const std::vector<int>& starts, const TwoDScene& scene, const VectorXs& x, scalar dt )
+{
+  if( starts.size() < 2 ) return;
+  const int ngroups = (int) starts.size() - 1;
+
+  // The last group holds constraints that did not fit in any color
+  for( int g = 0; g + 1 < ngroups; ++g )
+  {
+    #pragma omp parallel for schedule(static)
+    for( int k = starts[g]; k < starts[g+1]; ++k ) solveConstraint( constraints[order[k]], scene, x, dt );
+  }
+  for( int k = starts[ngroups-1]; k < starts[ngroups]; ++k ) solveConstraint( constraints[order[k]], scene, x, dt );
+}
+
+void XPBDStepper::solveConstraint( Constraint& c, const TwoDScene& scene, const VectorXs& x, scalar dt )
+{
+  switch( c.type )
+  {
+    case DISTANCE:
+    {
+      const int i = c.p[0];
+      const int j = c.p[1];
+      const scalar wsum = m_w(i) + m_w(j);
+      if( wsum == 0.0 ) return;
+
+      Vector2s d = m_p.segment<2>(2*i) - m_p.segment<2>(2*j);
+      const scalar len = d.norm();
+      if( len < kEpsilon ) return;
+      const Vector2s n = d/len;
+
+      const scalar C = len - c.l0;
+      const scalar alpha = c.compliance/(dt*dt);
+      const scalar gamma = c.compliance*c.damping/dt;
+      const scalar dCdt = n.dot( ( m_p.segment<2>(2*i) - x.segment<2>(2*i) ) - ( m_p.segment<2>(2*j) - x.segment<2>(2*j) ) );
+      const scalar dlambda = ( -C - alpha*c.lambda - gamma*dCdt )/( (1.0+gamma)*wsum + alpha );
+      c.lambda += dlambda;
+
+      if( m_w(i) != 0.0 ) m_p.segment<2>(2*i) += m_w(i)*dlambda*n;
+      if( m_w(j) != 0.0 ) m_p.segment<2>(2*j) -= m_w(j)*dlambda*n;
+      return;
+    }
+    case PARTICLE_PARTICLE:
+    {
+      const int i = c.p[0];
+      const int j = c.p[1];
+      const scalar wsum = m_w(i) + m_w(j);
+      if( wsum == 0.0 ) return;
+
+      Vector2s d = m_p.segment<2>(2*i) - m_p.segment<2>(2*j);
+      const scalar len = d.norm();
+      const scalar C = len - c.l0;
+      if( C >= 0.0 || len < kEpsilon ) return;
+      const Vector2s n = d/len;
+
+      const scalar dlambda = -C/wsum;
+      if( m_w(i) != 0.0 ) m_p.segment<2>(2*i) += m_w(i)*dlambda*n;
+      if( m_w(j) != 0.0 ) m_p.segment<2>(2*j) -= m_w(j)*dlambda*n;
+      return;
+    }
+    case PARTICLE_EDGE:
+    {
+      const int i = c.p[0];
+      const int e0 = c.p[1];
+      const int e1 = c.p[2];
+
+      const Vector2s a = m_p.segment<2>(2*e0);
+      const Vector2s e = m_p.segment<2>(2*e1) - a;
+      const scalar elen2 = e.squaredNorm();
+      scalar t = elen2 > kEpsilon ? ( m_p.segment<2>(2*i) - a ).dot(e)/elen2 : 0.0;
+      t = std::min( 1.0, std::max( 0.0, t ) );
+
+      Vector2s d = m_p.segment<2>(2*i) - ( a + t*e );
+      const scalar len = d.norm();
+      const scalar C = len - c.l0;
+      if( C >= 0.0 || len < kEpsilon ) return;
+      const Vector2s n = d/len;
+
+      const scalar wsum = m_w(i) + (1.0-t)*(1.0-t)*m_w(e0) + t*t*m_w(e1);
+      if( wsum == 0.0 ) return;
+      const scalar dlambda = -C/wsum;
+      if( m_w(i) != 0.0 ) m_p.segment<2>(2*i) += m_w(i)*dlambda*n;
+      if( m_w(e0) != 0.0 ) m_p.segment<2>(2*e0) -= m_w(e0)*(1.0-t)*dlambda*n;
+      if( m_w(e1) != 0.0 ) m_p.segment<2>(2*e1) -= m_w(e1)*t*dlambda*n;
+      return;
+    }
+    case PARTICLE_HALFPLANE:
+    {
+      const int i = c.p[0];
+      if( m_w(i) == 0.0 ) return;
+
+      const std::pair<VectorXs, VectorXs>& halfplane = scene.getHalfplane(c.halfplane);
+      const Vector2s n = halfplane.second.normalized();
+      const scalar C = ( m_p.segment<2>(2*i) - halfplane.first ).dot(n) - c.l0;
+      if( C >= 0.0 ) return;
+
+      m_p.segment<2>(2*i) -= C*n;
+      return;
+    }
+  }
+}
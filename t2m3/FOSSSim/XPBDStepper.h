@@ -0,0 +1,123 @@
+#ifndef __XPBD_STEPPER__
+#define __XPBD_STEPPER__
+
+#include <Eigen/Dense>
+#include <iostream>
+#include <vector>
+
+#include "SceneStepper.h"
+#include "BatchDetectionCallback.h"
+
+// Extended position based dynamics (Macklin et al. 2016). Every SpringForce in
+// the scene becomes a compliant distance constraint (compliance 1/k, with the
+// spring's b as constraint damping) and every contact reported by the
+// collision detector becomes a hard inequality constraint. All other forces
+// are applied explicitly when predicting positions.
+//
+// Constraints are greedily graph colored so that no two constraints of the
+// same color move the same particle; each color is then projected as a
+// parallel Gauss-Seidel sweep. Fixed particles never move, so they do not
+// create conflicts. The spring coloring is cached until the scene's force list
+// or the set of fixed particles changes, contacts are recolored every step.
+class XPBDStepper : public SceneStepper
+{
+public:
+  // The detector is not owned by the stepper and may be NULL, in which case
+  // contacts are ignored.
+  XPBDStepper( CollisionDetector* detector = NULL, int iterations = 10 );
+  
+  virtual ~XPBDStepper();
+  
+  virtual bool stepScene( TwoDScene& scene, scalar dt );
+  
+  virtual std::string getName() const;
+
+  int getNumSpringColors() const;
+  int getNumContacts() const;
+
+private:
+  enum ConstraintType { DISTANCE, PARTICLE_PARTICLE, PARTICLE_EDGE, PARTICLE_HALFPLANE };
+
+  struct Constraint
+  {
+    ConstraintType type;
+    // Particle indices, -1 for unused slots. For PARTICLE_EDGE, p[1] and p[2]
+    // are the edge's endpoints.
+    int p[3];
+    // Halfplane index for PARTICLE_HALFPLANE
+    int halfplane;
+    // Rest length for DISTANCE, minimum separation (sum of radii) for contacts
+    scalar l0;
+    scalar compliance;
+    scalar damping;
+    scalar lambda;
+  };
+
+  // Collects the detector's candidate pairs as contact constraints. Candidates
+  // are first checked against the predicted positions and only those within
+  // a small margin of touching are kept, so the contacts do not depend on how
+  // loose the detector's broad phase is.
+  class ContactCollector : public BatchDetectionCallback
+  {
+  public:
+    ContactCollector( const TwoDScene& scene, const VectorXs& p, std::vector<Constraint>& contacts );
+
+    virtual void ParticleParticleCallback( int idx1, int idx2 );
+    virtual void ParticleEdgeCallback( int vidx, int eidx );
+    virtual void ParticleHalfplaneCallback( int vidx, int hidx );
+
+    virtual void ParticleParticleBatch( const int* idx1, const int* idx2, int count );
+    virtual void ParticleEdgeBatch( const int* vidx, const int* eidx, int count );
+    virtual void ParticleHalfplaneBatch( const int* vidx, const int* hidx, int count );
+
+  private:
+    void addContact( ConstraintType type, int p0, int p1, int p2, int halfplane, scalar l0 );
+
+    const TwoDScene& m_scene;
+    const VectorXs& m_p;
+    std::vector<Constraint>& m_contacts;
+
+    // Per batch scratch: each candidate's distance and, for edges, the
+    // endpoints
+    std::vector<scalar> m_dist;
+    std::vector<int> m_first;
+    std::vector<int> m_second;
+    // (px, py, nx, ny) of every halfplane, in NarrowPhase's layout
+    std::vector<scalar> m_planes;
+  };
+
+  // Groups constraints by color. On return order holds constraint indices
+  // sorted by color and color i occupies [starts[i], starts[i+1]). Constraints
+  // that do not fit in the available colors land in a final group that must be
+  // solved serially.
+  void colorConstraints( const std::vector<Constraint>& constraints, std::vector<int>& order, std::vector<int>& starts );
+
+  void buildSpringConstraints( const TwoDScene& scene );
+
+  void solveGroups( std::vector<Constraint>& constraints, const std::vector<int>& order, const std::vector<int>& starts, const TwoDScene& scene, const VectorXs& x, scalar dt );
+
+  void solveConstraint( Constraint& c, const TwoDScene& scene, const VectorXs& x, scalar dt );
+
+  CollisionDetector* m_detector;
+  int m_iterations;
+
+  std::vector<Force*> m_cached_forces;
+  std::vector<bool> m_cached_fixed;
+  std::vector<Force*> m_explicit_forces;
+  std::vector<Constraint> m_springs;
+  std::vector<int> m_spring_order;
+  std::vector<int> m_spring_starts;
+
+  std::vector<Constraint> m_contacts;
+  std::vector<int> m_contact_order;
+  std::vector<int> m_contact_starts;
+
+  // Predicted positions, inverse masses (one per particle, zero if fixed) and force scratch space
+  VectorXs m_p;
+  VectorXs m_w;
+  VectorXs m_gradE;
+  // Per particle color masks used while coloring
+  std::vector<unsigned long long> m_color_masks;
+};
+
+#endif
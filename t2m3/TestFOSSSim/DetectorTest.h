@@ -0,0 +1,244 @@
+#ifndef __DETECTOR_TEST_H__
+#define __DETECTOR_TEST_H__
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "FOSSSim/TwoDScene.h"
+#include "FOSSSim/ContestDetector.h"
+#include "FOSSSim/SweepAndPruneDetector.h"
+#include "FOSSSim/BatchDetectionCallback.h"
+#include "SceneLoader.h"
+
+namespace
+{
+  typedef std::set< std::pair<int,int> > PairSet;
+
+  // Records every reported pair. Particle-particle pairs are stored with the
+  // lower index first, since detectors may report either order.
+  class PairRecorder : public DetectionCallback
+  {
+  public:
+    virtual void ParticleParticleCallback( int idx1, int idx2 ) { pppairs.insert( std::make_pair( std::min( idx1, idx2 ), std::max( idx1, idx2 ) ) ); }
+    virtual void ParticleEdgeCallback( int vidx, int eidx ) { pepairs.insert( std::make_pair( vidx, eidx ) ); }
+    virtual void ParticleHalfplaneCallback( int vidx, int hidx ) { phpairs.insert( std::make_pair( vidx, hidx ) ); }
+
+    PairSet pppairs;
+    PairSet pepairs;
+    PairSet phpairs;
+  };
+
+  // The same, but takes the batched delivery path
+  class BatchPairRecorder : public BatchDetectionCallback
+  {
+  public:
+    virtual void ParticleParticleCallback( int idx1, int idx2 ) { pairs.ParticleParticleCallback( idx1, idx2 ); }
+    virtual void ParticleEdgeCallback( int vidx, int eidx ) { pairs.ParticleEdgeCallback( vidx, eidx ); }
+    virtual void ParticleHalfplaneCallback( int vidx, int hidx ) { pairs.ParticleHalfplaneCallback( vidx, hidx ); }
+
+    PairRecorder pairs;
+  };
+
+  scalar uniform( scalar lo, scalar hi )
+  {
+    return lo + ( hi - lo )*( std::rand()/(scalar) RAND_MAX );
+  }
+
+  void expectSamePairs( ContestDetector& contest, SweepAndPruneDetector& sap, const TwoDScene& scene, const VectorXs& qs, const VectorXs& qe, const std::string& what )
+  {
+    PairRecorder expected;
+    contest.performCollisionDetection( scene, qs, qe, expected );
+
+    PairRecorder single;
+    sap.performCollisionDetection( scene, qs, qe, single );
+    EXPECT_EQ( expected.pppairs.size(), single.pppairs.size() ) << what;
+    EXPECT_TRUE( expected.pppairs == single.pppairs ) << what;
+    EXPECT_EQ( expected.pepairs.size(), single.pepairs.size() ) << what;
+    EXPECT_TRUE( expected.pepairs == single.pepairs ) << what;
+    EXPECT_EQ( expected.phpairs.size(), single.phpairs.size() ) << what;
+    EXPECT_TRUE( expected.phpairs == single.phpairs ) << what;
+
+    BatchPairRecorder batched;
+    sap.performCollisionDetection( scene, qs, qe, batched );
+    EXPECT_TRUE( expected.pppairs == batched.pairs.pppairs ) << what << " (batched)";
+    EXPECT_TRUE( expected.pepairs == batched.pairs.pepairs ) << what << " (batched)";
+    EXPECT_TRUE( expected.phpairs == batched.pairs.phpairs ) << what << " (batched)";
+  }
+}
+
+// SweepAndPruneDetector has to report exactly ContestDetector's pairs, both
+// for discrete detection and for swept motion, on every t2m3 scene. Each
+// scene is flown ballistically from its initial velocities, which is enough
+// to bring its particles into contact with each other and the halfplanes,
+// with a little jitter on top so the positions are not all axis aligned.
+TEST(SweepAndPrune, MatchesContestDetector)
+{
+  const char* const scenes[] =
+  {
+    "t2m3/TestingScenes/test00.xml",
+    "t2m3/TestingScenes/test01.xml",
+    "t2m3/TestingScenes/test02.xml",
+    "t2m3/TestingScenes/test03.xml",
+    "t2m3/TestingScenes/test04.xml",
+    "t2m3/TimingScenes/test01.xml"
+  };
+  const int nsteps = 200;
+
+  std::srand( 1 );
+  for( unsigned s = 0; s < sizeof(scenes)/sizeof(scenes[0]); ++s )
+  {
+    TwoDScene scene;
+    scalar dt;
+    ASSERT_TRUE( loadScene( assetPath( scenes[s] ), scene, dt ) ) << scenes[s];
+
+    const int nparticles = scene.getNumParticles();
+    scalar mean_radius = 0.0;
+    for( int i = 0; i < nparticles; ++i ) mean_radius += scene.getRadius(i);
+    mean_radius /= std::max( nparticles, 1 );
+    const scalar jitter = 0.05*mean_radius;
+
+    ContestDetector contest;
+    SweepAndPruneDetector sap;
+    VectorXs qs = scene.getX();
+    for( int step = 0; step < nsteps; ++step )
+    {
+      VectorXs qe = qs + dt*scene.getV();
+      for( int k = 0; k < qe.size(); ++k ) qe(k) += uniform( -jitter, jitter );
+
+      std::ostringstream where;
+      where << scenes[s] << ", step " << step;
+      expectSamePairs( contest, sap, scene, qs, qs, where.str() + ", discrete" );
+      expectSamePairs( contest, sap, scene, qs, qe, where.str() + ", swept" );
+      qs = qe;
+    }
+  }
+}
+
+// Pairs separated by less than kContactTolerance are contacts to both
+// detectors
+TEST(SweepAndPrune, GrazingContacts)
+{
+  const scalar radius = 0.2;
+  const scalar gap = 0.5*kContactTolerance;
+
+  TwoDScene scene;
+  scene.resizeSystem( 2 );
+  for( int i = 0; i < 2; ++i )
+  {
+    scene.setMass( i, 1.0 );
+    scene.setFixed( i, false );
+    scene.setRadius( i, radius );
+    scene.setVelocity( i, Vector2s::Zero() );
+  }
+  scene.setPosition( 0, Vector2s( 0.0, radius + gap ) );
+  scene.setPosition( 1, Vector2s( 2.0*radius + gap, radius + gap ) );
+
+  VectorXs position(2), normal(2);
+  position << 0.0, 0.0;
+  normal << 0.0, 1.0;
+  scene.insertHalfplane( std::make_pair( position, normal ) );
+
+  ContestDetector contest;
+  SweepAndPruneDetector sap;
+  expectSamePairs( contest, sap, scene, scene.getX(), scene.getX(), "grazing" );
+
+  PairRecorder pairs;
+  sap.performCollisionDetection( scene, scene.getX(), scene.getX(), pairs );
+  EXPECT_EQ( 1u, pairs.pppairs.size() );
+  EXPECT_EQ( 2u, pairs.phpairs.size() );
+}
+
+// Reusing the neighbour lists while particles drift within the skin gives
+// exactly the pairs of a fresh build, for discrete and swept detection. The
+// positions random walk, so the lists are both reused and rebuilt.
+TEST(ContestDetector, NeighbourListsMatchFreshBuild)
+{
+  const char* const scenes[] =
+  {
+    "t2m3/TestingScenes/test01.xml",
+    "t2m3/TestingScenes/test03.xml",
+    "t2m3/TimingScenes/test01.xml"
+  };
+  const int ncalls = 200;
+
+  std::srand( 3 );
+  for( unsigned s = 0; s < sizeof(scenes)/sizeof(scenes[0]); ++s )
+  {
+    TwoDScene scene;
+    scalar dt;
+    ASSERT_TRUE( loadScene( assetPath( scenes[s] ), scene, dt ) ) << scenes[s];
+
+    const int nparticles = scene.getNumParticles();
+    scalar mean_radius = 0.0;
+    for( int i = 0; i < nparticles; ++i ) mean_radius += scene.getRadius(i);
+    mean_radius /= std::max( nparticles, 1 );
+    const scalar jitter = 0.05*mean_radius;
+
+    ContestDetector reused;
+    VectorXs qs = scene.getX();
+    for( int call = 0; call < ncalls; ++call )
+    {
+      VectorXs qe = qs;
+      for( int k = 0; k < qe.size(); ++k ) qe(k) += uniform( -jitter, jitter );
+      const VectorXs& q1 = ( call%2 ) ? qe : qs;
+
+      PairRecorder pairs;
+      reused.performCollisionDetection( scene, qs, q1, pairs );
+      PairRecorder expected;
+      ContestDetector fresh;
+      fresh.performCollisionDetection( scene, qs, q1, expected );
+      EXPECT_TRUE( expected.pppairs == pairs.pppairs ) << scenes[s] << ", call " << call;
+      EXPECT_TRUE( expected.pepairs == pairs.pepairs ) << scenes[s] << ", call " << call;
+      EXPECT_TRUE( expected.phpairs == pairs.phpairs ) << scenes[s] << ", call " << call;
+      qs = qe;
+    }
+
+    EXPECT_GT( reused.getNumNeighbourListBuilds(), 1 ) << scenes[s];
+    EXPECT_LT( reused.getNumNeighbourListBuilds(), ncalls/2 ) << scenes[s];
+  }
+}
+
+// Each detector keeps its own neighbour lists, so detectors alternating
+// between far apart configurations neither rebuild nor report each other's
+// pairs
+TEST(ContestDetector, InstancesKeepTheirOwnNeighbourLists)
+{
+  TwoDScene scene;
+  scalar dt;
+  ASSERT_TRUE( loadScene( assetPath( "t2m3/TestingScenes/test03.xml" ), scene, dt ) );
+
+  const int nparticles = scene.getNumParticles();
+  scalar mean_radius = 0.0;
+  for( int i = 0; i < nparticles; ++i ) mean_radius += scene.getRadius(i);
+  mean_radius /= std::max( nparticles, 1 );
+  const scalar jitter = 0.01*mean_radius;
+
+  const VectorXs base[] = { scene.getX(), -scene.getX() };
+  ContestDetector detectors[2];
+
+  std::srand( 1 );
+  for( int call = 0; call < 20; ++call )
+  {
+    const int d = call%2;
+    VectorXs q = base[d];
+    for( int k = 0; k < q.size(); ++k ) q(k) += uniform( -jitter, jitter );
+
+    PairRecorder pairs;
+    detectors[d].performCollisionDetection( scene, q, q, pairs );
+    PairRecorder expected;
+    ContestDetector fresh;
+    fresh.performCollisionDetection( scene, q, q, expected );
+    EXPECT_TRUE( expected.pppairs == pairs.pppairs ) << "call " << call;
+    EXPECT_TRUE( expected.pepairs == pairs.pepairs ) << "call " << call;
+    EXPECT_TRUE( expected.phpairs == pairs.phpairs ) << "call " << call;
+  }
+
+  EXPECT_EQ( 1, detectors[0].getNumNeighbourListBuilds() );
+  EXPECT_EQ( 1, detectors[1].getNumNeighbourListBuilds() );
+}
+
+#endif
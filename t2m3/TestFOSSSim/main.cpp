@@ -2,10 +2,11 @@
 #include <string>
 
 #include "SampleTest.h"
+#include "DetectorTest.h"
 
 
 int main( int argc, char **argv ) 
 {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}